@@ -20,6 +20,8 @@
 #include "util.h"
 
 #include <QTextStream>
+#include <QCryptographicHash>
+#include <QHash>
 #include <QSet>
 #include <QtAlgorithms>
 #include <QDebug>
@@ -29,6 +31,7 @@ Graph::Graph(QObject *parent) : QObject(parent)
 {
     _data = new GraphElementData(this);
     _bbox = QRectF(0,0,0,0);
+    _nodeBoundsValid = true;
 }
 
 Graph::~Graph()
@@ -38,19 +41,25 @@ Graph::~Graph()
 // add a node. The graph claims ownership.
 void Graph::addNode(Node *n) {
     n->setParent(this);
+    n->setGraph(this);
     _nodes << n;
+    extendNodeBounds(n->point());
 }
 
 void Graph::addNode(Node *n, int index)
 {
     n->setParent(this);
+    n->setGraph(this);
     _nodes.insert(index, n);
+    extendNodeBounds(n->point());
 }
 
 void Graph::removeNode(Node *n) {
     // the node itself is not deleted, as it may still be referenced in an undo command. It will
     // be deleted when graph is, via QObject memory management.
     _nodes.removeOne(n);
+    n->setGraph(nullptr);
+    if (onNodeBounds(n->point())) _nodeBoundsValid = false;
 }
 
 
@@ -58,12 +67,14 @@ void Graph::addEdge(Edge *e)
 {
     e->setParent(this);
     _edges << e;
+    addAdjacentEdge(e);
 }
 
 void Graph::addEdge(Edge *e, int index)
 {
     e->setParent(this);
     _edges.insert(index, e);
+    addAdjacentEdge(e);
 }
 
 void Graph::removeEdge(Edge *e)
@@ -71,6 +82,20 @@ void Graph::removeEdge(Edge *e)
     // the edge itself is not deleted, as it may still be referenced in an undo command. It will
     // be deleted when graph is, via QObject memory management.
     _edges.removeOne(e);
+    _adjacentEdges.remove(e->source(), e);
+    _adjacentEdges.remove(e->target(), e);
+}
+
+void Graph::addAdjacentEdge(Edge *e)
+{
+    _adjacentEdges.insert(e->source(), e);
+    // a loop is only recorded once
+    if (e->target() != e->source()) _adjacentEdges.insert(e->target(), e);
+}
+
+QList<Edge *> Graph::adjacentEdges(Node *n) const
+{
+    return _adjacentEdges.values(n);
 }
 
 void Graph::addPath(Path *p)
@@ -106,19 +131,99 @@ void Graph::reorderEdges(const QVector<Edge *> &newOrder)
     _edges = newOrder;
 }
 
+// merge the moved elements into the remaining ones, so each lands at its new index
+template <class T>
+static void moveElements(QVector<T*> &order, const QVector<T*> &moved, const QVector<int> &indices)
+{
+    QSet<T*> movedSet;
+    foreach (T *t, moved) movedSet << t;
+
+    QVector<T*> newOrder;
+    newOrder.reserve(order.size());
+    int j = 0;
+    foreach (T *t, order) {
+        if (movedSet.contains(t)) continue;
+        while (j < moved.size() && indices[j] == newOrder.size()) newOrder << moved[j++];
+        newOrder << t;
+    }
+    while (j < moved.size()) newOrder << moved[j++];
+
+    order = newOrder;
+}
+
+void Graph::moveNodes(const QVector<Node *> &nodes, const QVector<int> &indices)
+{
+    moveElements(_nodes, nodes, indices);
+}
+
+void Graph::moveEdges(const QVector<Edge *> &edges, const QVector<int> &indices)
+{
+    moveElements(_edges, edges, indices);
+}
+
 QRectF Graph::realBbox()
 {
-    //float maxX = 0.0f;
     QRectF rect = bbox();
-    foreach (Node *n, _nodes) {
-        rect = rect.united(QRectF(n->point().x()-0.5f,
-                                  n->point().y()-0.5f,
-                                  1.0f, 1.0f));
+    if (!_nodes.isEmpty()) {
+        QRectF nb = nodeBounds();
+        rect = rect.united(nb.adjusted(-0.5f, -0.5f, 0.5f, 0.5f));
     }
 
     return rect;
 }
 
+QRectF Graph::nodeBounds()
+{
+    if (_nodes.isEmpty()) return QRectF();
+
+    if (!_nodeBoundsValid) {
+        _minX = _maxX = _nodes.first()->point().x();
+        _minY = _maxY = _nodes.first()->point().y();
+        _nodeBoundsValid = true;
+        foreach (Node *n, _nodes) extendNodeBounds(n->point());
+    }
+
+    return QRectF(QPointF(_minX, _minY), QPointF(_maxX, _maxY));
+}
+
+void Graph::nodeMoved(const QPointF &oldPoint, const QPointF &newPoint)
+{
+    if (!_nodeBoundsValid) return;
+
+    // the bounds can only shrink if the node was on one of their sides and moved
+    // away from it, towards the inside. Then they are recomputed lazily.
+    if ((oldPoint.x() <= _minX && newPoint.x() > oldPoint.x()) ||
+        (oldPoint.x() >= _maxX && newPoint.x() < oldPoint.x()) ||
+        (oldPoint.y() <= _minY && newPoint.y() > oldPoint.y()) ||
+        (oldPoint.y() >= _maxY && newPoint.y() < oldPoint.y()))
+    {
+        _nodeBoundsValid = false;
+    } else {
+        extendNodeBounds(newPoint);
+    }
+}
+
+void Graph::extendNodeBounds(const QPointF &p)
+{
+    if (!_nodeBoundsValid) return;
+
+    if (_nodes.size() == 1) {
+        _minX = _maxX = p.x();
+        _minY = _maxY = p.y();
+    } else {
+        if (p.x() < _minX) _minX = p.x();
+        if (p.x() > _maxX) _maxX = p.x();
+        if (p.y() < _minY) _minY = p.y();
+        if (p.y() > _maxY) _maxY = p.y();
+    }
+}
+
+bool Graph::onNodeBounds(const QPointF &p) const
+{
+    return _nodeBoundsValid &&
+           (p.x() <= _minX || p.x() >= _maxX || p.y() <= _minY || p.y() >= _maxY);
+}
+
 QRectF Graph::boundsForNodes(QSet<Node*>nds) {
 	QPointF p;
 	QPointF tl;
@@ -201,6 +306,8 @@ QString Graph::tikz()
     QString str;
     QTextStream code(&str);
     int line = 0;
+    int start;
+    _sourceMap.clear();
 
     code << "\\begin{tikzpicture}" << _data->tikz() << "\n";
     line++;
@@ -221,7 +328,10 @@ QString Graph::tikz()
     Node *n;
     foreach (n, _nodes) {
         n->setTikzLine(line);
-        code << "\t\t\\node ";
+        code << "\t\t";
+        code.flush();
+        start = str.length();
+        code << "\\node ";
 
         if (!n->data()->isEmpty())
             code << n->data()->tikz() << " ";
@@ -230,7 +340,10 @@ QString Graph::tikz()
              << floatToString(n->point().x())
              << ", "
              << floatToString(n->point().y())
-             << ") {" << n->label() << "};\n";
+             << ") {" << n->label() << "};";
+        code.flush();
+        _sourceMap.addNode(n, start, str.length());
+        code << "\n";
         line++;
     }
 
@@ -253,7 +366,10 @@ QString Graph::tikz()
             if (p->edges().first() == e) { // only add tikz code once per path
                 e->setTikzLine(line);
                 e->updateData();
-                code << "\t\t\\draw ";
+                code << "\t\t";
+                code.flush();
+                start = str.length();
+                code << "\\draw ";
 
                 GraphElementData *npd = e->data()->nonPathData();
                 if (!npd->isEmpty())
@@ -269,7 +385,13 @@ QString Graph::tikz()
                 code << ")";
 
                 foreach (Edge *e1, p->edges()) {
-                    code << "\n\t\t\t to ";
+                    code << "\n\t\t\t ";
+                    // the first edge also covers the start of the \draw command
+                    if (e1 != e) {
+                        code.flush();
+                        start = str.length();
+                    }
+                    code << "to ";
                     line++;
                     e1->setTikzLine(line);
                     e1->updateData();
@@ -297,6 +419,8 @@ QString Graph::tikz()
                         }
                         code << ")";
                     }
+                    code.flush();
+                    _sourceMap.addEdge(e1, start, str.length());
                 }
                 code << ";\n";
                 line++;
@@ -304,7 +428,10 @@ QString Graph::tikz()
         } else { // edge is not part of a path
             e->setTikzLine(line);
             e->updateData();
-            code << "\t\t\\draw ";
+            code << "\t\t";
+            code.flush();
+            start = str.length();
+            code << "\\draw ";
 
             if (!e->data()->isEmpty())
                 code << e->data()->tikz() << " ";
@@ -330,7 +457,10 @@ QString Graph::tikz()
                 code << ")";
             }
 
-            code << ";\n";
+            code << ";";
+            code.flush();
+            _sourceMap.addEdge(e, start, str.length());
+            code << "\n";
             line++;
         }
     }
@@ -347,6 +477,53 @@ QString Graph::tikz()
     return str;
 }
 
+QByteArray Graph::texKey()
+{
+    // nodes are referred to by position, so renaming them changes nothing
+    QHash<Node*,int> nodeIndex;
+    for (int i = 0; i < _nodes.size(); ++i) nodeIndex.insert(_nodes[i], i);
+    QHash<Path*,int> pathIndex;
+    for (int i = 0; i < _paths.size(); ++i) pathIndex.insert(_paths[i], i);
+
+    QString str;
+    QTextStream code(&str);
+    code << "graph [" << _data->texCode() << "]\n";
+    if (hasBbox()) {
+        code << "bbox "
+             << floatToString(_bbox.left()) << " " << floatToString(_bbox.top()) << " "
+             << floatToString(_bbox.right()) << " " << floatToString(_bbox.bottom()) << "\n";
+    }
+
+    // the order still matters, since TikZ draws things in the order they appear
+    foreach (Node *n, _nodes) {
+        code << "node [" << n->data()->texCode() << "] "
+             << floatToString(n->point().x()) << " "
+             << floatToString(n->point().y()) << " {" << n->label() << "}\n";
+    }
+
+    foreach (Edge *e, _edges) {
+        e->updateData();
+        Path *p = e->path();
+        if (p) code << "path " << pathIndex.value(p) << (p->isCycle() ? " cycle " : " ");
+        code << "edge [" << e->data()->texCode() << "] "
+             << nodeIndex.value(e->source(), -1) << "." << e->sourceAnchor() << " "
+             << nodeIndex.value(e->target(), -1) << "." << e->targetAnchor();
+        if (e->hasEdgeNode()) {
+            code << " node [" << e->edgeNode()->data()->texCode() << "] {"
+                 << e->edgeNode()->label() << "}";
+        }
+        code << "\n";
+    }
+
+    code.flush();
+    return QCryptographicHash::hash(str.toUtf8(), QCryptographicHash::Sha1);
+}
+
+const SourceMap &Graph::sourceMap() const
+{
+    return _sourceMap;
+}
+
 Graph *Graph::copyOfSubgraphWithNodes(QSet<Node *> nds)
 {
     Graph *g = new Graph();
@@ -27,6 +27,7 @@
 #include "edge.h"
 #include "path.h"
 #include "graphelementdata.h"
+#include "sourcemap.h"
 
 #include <QObject>
 #include <QVector>
@@ -52,6 +53,15 @@ public:
     int maxIntName();
     void reorderNodes(const QVector<Node*> &newOrder);
     void reorderEdges(const QVector<Edge*> &newOrder);
+
+    /*!
+     * \brief moveNodes moves the given nodes to the given (ascending) positions in the
+     * node order. All other nodes keep their relative order.
+     * \param nodes the nodes to move, in the order of their new positions
+     * \param indices the new positions
+     */
+    void moveNodes(const QVector<Node*> &nodes, const QVector<int> &indices);
+    void moveEdges(const QVector<Edge*> &edges, const QVector<int> &indices);
 	QRectF boundsForNodes(QSet<Node*> ns);
 	QString freshNodeName();
 
@@ -69,6 +79,13 @@ public:
     const QVector<Edge*> &edges();
     const QVector<Path*> &paths();
 
+    /*!
+     * \brief adjacentEdges returns the edges with the given node as source or target.
+     * This is kept up to date as edges are added and removed, so it does not scan the
+     * edge list.
+     */
+    QList<Edge*> adjacentEdges(Node *n) const;
+
     QRectF bbox() const;
     void setBbox(const QRectF &bbox);
     bool hasBbox();
@@ -83,8 +100,36 @@ public:
      */
     QRectF realBbox();
 
+    /*!
+     * \brief nodeBounds returns the smallest rectangle containing the positions of
+     * all of the nodes. This is kept up to date as nodes are added, moved and
+     * removed, and only recomputed from scratch when a node on the boundary moves
+     * inwards or is removed.
+     * \return the bounds, or a null rectangle if the graph has no nodes
+     */
+    QRectF nodeBounds();
+
+    /*!
+     * \brief nodeMoved is called by a node of this graph when its position changes.
+     */
+    void nodeMoved(const QPointF &oldPoint, const QPointF &newPoint);
+
     QString tikz();
 
+    /*!
+     * \brief texKey returns a hash of everything about the graph that makes a
+     * difference to the picture TeX produces. It ignores node names, properties
+     * only used by TikZiT, formatting, and changes to coordinates that are too
+     * small to show up in the tikz code.
+     */
+    QByteArray texKey();
+
+    /*!
+     * \brief sourceMap returns the positions of the nodes and edges in the code
+     * most recently produced by tikz().
+     */
+    const SourceMap &sourceMap() const;
+
     /*!
      * \brief copyOfSubgraphWithNodes produces a copy of the full subgraph
      * with the given nodes. Used for cutting and copying to clipboard.
@@ -126,10 +171,16 @@ private:
     QVector<Node*> _nodes;
     QVector<Edge*> _edges;
     QVector<Path*> _paths;
-    //QMultiHash<Node*,Edge*> inEdges;
-    //QMultiHash<Node*,Edge*> outEdges;
+
+    void extendNodeBounds(const QPointF &p);
+    bool onNodeBounds(const QPointF &p) const;
+    bool _nodeBoundsValid;
+    qreal _minX, _maxX, _minY, _maxY;
+    QMultiHash<Node*,Edge*> _adjacentEdges;
+    void addAdjacentEdge(Edge *e);
     GraphElementData *_data;
     QRectF _bbox;
+    SourceMap _sourceMap;
 };
 
 #endif // GRAPH_H
@@ -20,6 +20,7 @@
 
 #include <QDebug>
 #include <QTextStream>
+#include <QStringList>
 
 GraphElementData::GraphElementData(QVector<GraphElementProperty> init, QObject *parent) : QAbstractItemModel(parent)
 {
@@ -256,6 +257,22 @@ QString GraphElementData::tikz() {
     return str;
 }
 
+QString GraphElementData::texCode() const
+{
+    QStringList props;
+    foreach (GraphElementProperty p, _properties) {
+        if (isTikzitProperty(p.key())) continue;
+        if (p.atom()) props << p.key().simplified();
+        else props << p.key().simplified() + "=" + p.value().simplified();
+    }
+    return props.join(", ");
+}
+
+bool GraphElementData::isTikzitProperty(QString key)
+{
+    return key.startsWith("tikzit ");
+}
+
 bool GraphElementData::isEmpty()
 {
     return _properties.isEmpty();
@@ -75,6 +75,14 @@ public:
     void add(GraphElementProperty p);
 
     QString tikz();
+
+    /*!
+     * \brief texCode returns the properties that make a difference to TeX, in a
+     * canonical form. Properties starting with "tikzit", which only affect how
+     * TikZiT draws things, are left out, as is extra whitespace.
+     */
+    QString texCode() const;
+    static bool isTikzitProperty(QString key);
     bool isEmpty();
     QVector<GraphElementProperty> properties() const;
 
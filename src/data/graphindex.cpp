@@ -0,0 +1,241 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "graphindex.h"
+
+#include <cmath>
+#include <algorithm>
+
+// side length of a grid cell, in graph coordinates
+#define GRAPH_INDEX_CELL 2.0
+
+// edges whose bounds cover more cells than this are not bucketed
+#define GRAPH_INDEX_MAX_EDGE_CELLS 64
+
+// cell coordinates are clamped to this, so far-away query rectangles can't overflow
+#define GRAPH_INDEX_MAX_CELL 1000000000.0
+
+GraphIndex::GraphIndex() : _valid(false)
+{
+}
+
+GraphIndex::Cell GraphIndex::cellFor(QPointF p) const
+{
+    qreal x = qBound(-GRAPH_INDEX_MAX_CELL, std::floor(p.x() / GRAPH_INDEX_CELL), GRAPH_INDEX_MAX_CELL);
+    qreal y = qBound(-GRAPH_INDEX_MAX_CELL, std::floor(p.y() / GRAPH_INDEX_CELL), GRAPH_INDEX_MAX_CELL);
+    return Cell(static_cast<int>(x), static_cast<int>(y));
+}
+
+qint64 GraphIndex::cellCount(Cell c0, Cell c1)
+{
+    return (qint64(c1.first) - c0.first + 1) * (qint64(c1.second) - c0.second + 1);
+}
+
+bool GraphIndex::cellInRange(Cell c, Cell c0, Cell c1)
+{
+    return c.first >= c0.first && c.first <= c1.first &&
+           c.second >= c0.second && c.second <= c1.second;
+}
+
+QRectF GraphIndex::edgeBounds(Edge *e) const
+{
+    QPointF pts[4] = { e->tail(), e->cp1(), e->cp2(), e->head() };
+    qreal minX = pts[0].x(), maxX = pts[0].x();
+    qreal minY = pts[0].y(), maxY = pts[0].y();
+    for (int j = 1; j < 4; ++j) {
+        minX = std::min(minX, pts[j].x());
+        maxX = std::max(maxX, pts[j].x());
+        minY = std::min(minY, pts[j].y());
+        maxY = std::max(maxY, pts[j].y());
+    }
+    // pad the bounds, so straight horizontal and vertical edges have a non-empty area
+    return QRectF(QPointF(minX - 0.25, minY - 0.25), QPointF(maxX + 0.25, maxY + 0.25));
+}
+
+bool GraphIndex::isLarge(const QRectF &bounds) const
+{
+    Cell c0 = cellFor(bounds.topLeft());
+    Cell c1 = cellFor(bounds.bottomRight());
+    return cellCount(c0, c1) > GRAPH_INDEX_MAX_EDGE_CELLS;
+}
+
+void GraphIndex::build(Graph *graph)
+{
+    invalidate();
+    _valid = true;
+
+    _nodePoints.reserve(graph->nodes().size());
+    foreach (Node *n, graph->nodes()) updateNode(n);
+
+    _edgeBounds.reserve(graph->edges().size());
+    foreach (Edge *e, graph->edges()) updateEdge(e);
+}
+
+void GraphIndex::invalidate()
+{
+    _nodeCells.clear();
+    _edgeCells.clear();
+    _nodePoints.clear();
+    _edgeBounds.clear();
+    _largeEdges.clear();
+    _valid = false;
+}
+
+bool GraphIndex::isValid() const
+{
+    return _valid;
+}
+
+void GraphIndex::updateNode(Node *n)
+{
+    if (!_valid) return;
+    QPointF p = n->point();
+    auto it = _nodePoints.find(n);
+    if (it != _nodePoints.end()) {
+        if (it.value() == p) return;
+        Cell c = cellFor(it.value());
+        if (c == cellFor(p)) {
+            it.value() = p;
+            return;
+        }
+        _nodeCells[c].removeOne(n);
+        if (_nodeCells[c].isEmpty()) _nodeCells.remove(c);
+        it.value() = p;
+    } else {
+        _nodePoints.insert(n, p);
+    }
+    _nodeCells[cellFor(p)] << n;
+}
+
+void GraphIndex::removeNode(Node *n)
+{
+    auto it = _nodePoints.find(n);
+    if (it == _nodePoints.end()) return;
+    Cell c = cellFor(it.value());
+    _nodeCells[c].removeOne(n);
+    if (_nodeCells[c].isEmpty()) _nodeCells.remove(c);
+    _nodePoints.erase(it);
+}
+
+void GraphIndex::updateEdge(Edge *e)
+{
+    if (!_valid) return;
+    QRectF bounds = edgeBounds(e);
+    auto it = _edgeBounds.constFind(e);
+    if (it != _edgeBounds.constEnd() && it.value() == bounds) return;
+    removeEdge(e);
+
+    _edgeBounds.insert(e, bounds);
+    if (isLarge(bounds)) {
+        _largeEdges << e;
+    } else {
+        Cell c0 = cellFor(bounds.topLeft());
+        Cell c1 = cellFor(bounds.bottomRight());
+        for (int x = c0.first; x <= c1.first; ++x)
+            for (int y = c0.second; y <= c1.second; ++y)
+                _edgeCells[Cell(x,y)] << e;
+    }
+}
+
+void GraphIndex::removeEdge(Edge *e)
+{
+    auto it = _edgeBounds.find(e);
+    if (it == _edgeBounds.end()) return;
+    QRectF bounds = it.value();
+    _edgeBounds.erase(it);
+
+    if (isLarge(bounds)) {
+        _largeEdges.remove(e);
+    } else {
+        Cell c0 = cellFor(bounds.topLeft());
+        Cell c1 = cellFor(bounds.bottomRight());
+        for (int x = c0.first; x <= c1.first; ++x) {
+            for (int y = c0.second; y <= c1.second; ++y) {
+                Cell c(x,y);
+                _edgeCells[c].removeOne(e);
+                if (_edgeCells[c].isEmpty()) _edgeCells.remove(c);
+            }
+        }
+    }
+}
+
+QVector<Node*> GraphIndex::nodesIn(const QRectF &rect) const
+{
+    QVector<Node*> result;
+    QRectF r = rect.normalized();
+    Cell c0 = cellFor(r.topLeft());
+    Cell c1 = cellFor(r.bottomRight());
+
+    // a large rectangle (e.g. a view zoomed far out) covers mostly empty cells, so
+    // it is cheaper to visit the occupied ones
+    if (cellCount(c0, c1) > _nodeCells.size()) {
+        for (auto it = _nodeCells.constBegin(); it != _nodeCells.constEnd(); ++it) {
+            if (!cellInRange(it.key(), c0, c1)) continue;
+            foreach (Node *n, it.value()) {
+                if (r.contains(_nodePoints.value(n))) result << n;
+            }
+        }
+        return result;
+    }
+
+    for (int x = c0.first; x <= c1.first; ++x) {
+        for (int y = c0.second; y <= c1.second; ++y) {
+            auto it = _nodeCells.constFind(Cell(x,y));
+            if (it == _nodeCells.constEnd()) continue;
+            foreach (Node *n, it.value()) {
+                if (r.contains(_nodePoints.value(n))) result << n;
+            }
+        }
+    }
+
+    return result;
+}
+
+QVector<Edge*> GraphIndex::edgesIn(const QRectF &rect) const
+{
+    // edges can be bucketed in several cells, so collect them in a set
+    QSet<Edge*> result;
+    QRectF r = rect.normalized();
+    Cell c0 = cellFor(r.topLeft());
+    Cell c1 = cellFor(r.bottomRight());
+
+    if (cellCount(c0, c1) > _edgeCells.size()) {
+        for (auto it = _edgeCells.constBegin(); it != _edgeCells.constEnd(); ++it) {
+            if (!cellInRange(it.key(), c0, c1)) continue;
+            foreach (Edge *e, it.value()) {
+                if (r.intersects(_edgeBounds.value(e))) result << e;
+            }
+        }
+    } else {
+        for (int x = c0.first; x <= c1.first; ++x) {
+            for (int y = c0.second; y <= c1.second; ++y) {
+                auto it = _edgeCells.constFind(Cell(x,y));
+                if (it == _edgeCells.constEnd()) continue;
+                foreach (Edge *e, it.value()) {
+                    if (r.intersects(_edgeBounds.value(e))) result << e;
+                }
+            }
+        }
+    }
+
+    foreach (Edge *e, _largeEdges) {
+        if (r.intersects(_edgeBounds.value(e))) result << e;
+    }
+
+    return result.values().toVector();
+}
@@ -0,0 +1,90 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*!
+ * A uniform-grid spatial index over the nodes and edges of a Graph, used to
+ * answer "what is near this rectangle" queries without scanning the whole
+ * graph. The index refers to elements by pointer, so reordering the graph does
+ * not affect it. Elements that are added, removed or moved are updated one at a
+ * time, and the index is only rebuilt when the whole graph is replaced.
+ */
+
+#ifndef GRAPHINDEX_H
+#define GRAPHINDEX_H
+
+#include "graph.h"
+
+#include <QHash>
+#include <QPair>
+#include <QRectF>
+#include <QSet>
+#include <QVector>
+
+class GraphIndex
+{
+public:
+    GraphIndex();
+    void build(Graph *graph);
+    void invalidate();
+    bool isValid() const;
+
+    /*!
+     * \brief updateNode adds the node to the index, or moves it to its current
+     * position. Does nothing if the index is not valid.
+     */
+    void updateNode(Node *n);
+    void removeNode(Node *n);
+
+    /*!
+     * \brief updateEdge adds the edge to the index, or refreshes it after its
+     * control points have changed. Does nothing if the index is not valid.
+     */
+    void updateEdge(Edge *e);
+    void removeEdge(Edge *e);
+
+    /*!
+     * \brief nodesIn returns the nodes whose position lies in the given
+     * rectangle (in graph coordinates), in no particular order.
+     */
+    QVector<Node*> nodesIn(const QRectF &rect) const;
+
+    /*!
+     * \brief edgesIn returns the edges whose control polygon meets the given
+     * rectangle (in graph coordinates), each once, in no particular order.
+     */
+    QVector<Edge*> edgesIn(const QRectF &rect) const;
+
+private:
+    typedef QPair<int,int> Cell;
+    Cell cellFor(QPointF p) const;
+    static qint64 cellCount(Cell c0, Cell c1);
+    static bool cellInRange(Cell c, Cell c0, Cell c1);
+    QRectF edgeBounds(Edge *e) const;
+    bool isLarge(const QRectF &bounds) const;
+
+    QHash<Cell,QVector<Node*>> _nodeCells;
+    QHash<Cell,QVector<Edge*>> _edgeCells;
+    QHash<Node*,QPointF> _nodePoints;
+    QHash<Edge*,QRectF> _edgeBounds;
+
+    // edges spanning too many cells to be worth bucketing are always checked
+    QSet<Edge*> _largeEdges;
+    bool _valid;
+};
+
+#endif // GRAPHINDEX_H
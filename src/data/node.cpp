@@ -17,11 +17,12 @@
 */
 
 #include "node.h"
+#include "graph.h"
 #include "tikzit.h"
 
 #include <QDebug>
 
-Node::Node(QObject *parent) : QObject(parent), _tikzLine(-1)
+Node::Node(QObject *parent) : QObject(parent), _tikzLine(-1), _graph(nullptr)
 {
     _data = new GraphElementData(this);
     _style = noneStyle;
@@ -47,7 +48,9 @@ QPointF Node::point() const
 
 void Node::setPoint(const QPointF &point)
 {
+    QPointF oldPoint = _point;
     _point = point;
+    if (_graph) _graph->nodeMoved(oldPoint, point);
 }
 
 QString Node::name() const
@@ -118,3 +121,13 @@ void Node::setTikzLine(int tikzLine)
 {
     _tikzLine = tikzLine;
 }
+
+Graph *Node::graph() const
+{
+    return _graph;
+}
+
+void Node::setGraph(Graph *graph)
+{
+    _graph = graph;
+}
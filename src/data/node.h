@@ -26,6 +26,8 @@
 #include <QPointF>
 #include <QString>
 
+class Graph;
+
 class Node : public QObject
 {
     Q_OBJECT
@@ -57,6 +59,14 @@ public:
     int tikzLine() const;
     void setTikzLine(int tikzLine);
 
+    /*!
+     * \brief graph returns the graph that currently contains this node, if any. This
+     * is set by Graph::addNode and cleared by Graph::removeNode, and is used to keep
+     * the bounds of the graph up to date as the node moves.
+     */
+    Graph *graph() const;
+    void setGraph(Graph *graph);
+
 signals:
 
 public slots:
@@ -68,6 +78,7 @@ private:
     Style *_style;
     GraphElementData *_data;
     int _tikzLine;
+    Graph *_graph;
 };
 
 #endif // NODE_H
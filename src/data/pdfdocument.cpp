@@ -16,6 +16,25 @@ PdfDocument::PdfDocument(QString file, QObject *parent) : QObject(parent)
     _doc1->load(&f);
     f.close();
     //_doc1->load(file);
+
+    _requestId = 0;
+    _label = nullptr;
+    _ratio = 1.0;
+
+    _renderer = new PdfRenderer(_data);
+    _renderer->moveToThread(&_thread);
+    connect(&_thread, SIGNAL(finished()), _renderer, SLOT(deleteLater()));
+    connect(this, SIGNAL(renderRequested(int,QSize)), _renderer, SLOT(render(int,QSize)));
+    connect(_renderer, SIGNAL(rendered(int,QSize,QImage)), this, SLOT(pageRendered(int,QSize,QImage)));
+    _thread.start();
+}
+
+PdfDocument::~PdfDocument()
+{
+    // skip anything still queued, and wait for a rendering in progress to finish
+    _renderer->cancelBefore(_requestId + 1);
+    _thread.quit();
+    _thread.wait();
 }
 
 void PdfDocument::renderTo(QLabel *label, QRect rect)
@@ -34,12 +53,65 @@ void PdfDocument::renderTo(QLabel *label, QRect rect)
 
     int w1 = static_cast<int>(scale * w0);
     int h1 = static_cast<int>(scale * h0);
-    QImage qimg = _doc1->render(0, QSize(w1, h1));
-    QPixmap pm = QPixmap::fromImage(qimg);
-    pm.setDevicePixelRatio(ratio);
-    label->setPixmap(pm);
-    label->setAlignment(Qt::AlignCenter);
-    label->setStyleSheet("QLabel {background-color: white}");
+    if (w1 <= 0 || h1 <= 0) return;
+
+    _label = label;
+    _ratio = ratio;
+    _target = QSize(w1, h1);
+
+    // the exact size has been rendered before, so there is nothing more to do
+    for (int i = 0; i < _renders.size(); ++i) {
+        if (_renders[i].size() == _target) {
+            _renders.move(i, 0);
+            showImage(_renders[0], _target);
+            return;
+        }
+    }
+
+    // otherwise stretch the closest rendering, preferring one that is too big,
+    // until a sharp one is ready
+    int best = -1;
+    for (int i = 0; i < _renders.size(); ++i) {
+        if (best == -1) {
+            best = i;
+            continue;
+        }
+        int w = _renders[i].width();
+        int bw = _renders[best].width();
+        if ((w >= w1) != (bw >= w1)) {
+            if (w >= w1) best = i;
+        } else if (qAbs(w - w1) < qAbs(bw - w1)) {
+            best = i;
+        }
+    }
+    if (best != -1) showImage(_renders[best], _target);
+
+    ++_requestId;
+    _renderer->cancelBefore(_requestId);
+    emit renderRequested(_requestId, _target);
+}
+
+void PdfDocument::pageRendered(int id, QSize size, QImage image)
+{
+    _renders.prepend(image);
+    while (_renders.size() > PDF_RENDER_CACHE_SIZE) _renders.removeLast();
+
+    // a result for an older request is kept, but the label has moved on
+    if (id == _requestId && size == _target && _label != nullptr) {
+        showImage(image, size);
+    }
+}
+
+void PdfDocument::showImage(QImage image, QSize size)
+{
+    if (image.size() != size) {
+        image = image.scaled(size, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+    }
+    QPixmap pm = QPixmap::fromImage(image);
+    pm.setDevicePixelRatio(_ratio);
+    _label->setPixmap(pm);
+    _label->setAlignment(Qt::AlignCenter);
+    _label->setStyleSheet("QLabel {background-color: white}");
 }
 
 bool PdfDocument::isValid()
@@ -47,9 +119,9 @@ bool PdfDocument::isValid()
     return _doc1->pageCount() > 0;
 }
 
-bool PdfDocument::exportImage(QString file, const char *format, QSize outputSize)
+bool PdfDocument::exportImage(QString file, const char *format, QSize outputSize, int page)
 {
-    QImage img = asImage(outputSize);
+    QImage img = asImage(outputSize, page);
     if (!img.isNull()) return img.save(file, format);
     else return false;
 }
@@ -66,6 +138,13 @@ bool PdfDocument::exportPdf(QString file)
     return false;
 }
 
+TiledExport *PdfDocument::exportTiff(QString file, QSize outputSize, QObject *parent)
+{
+    if (!isValid()) return nullptr;
+    if (outputSize.isNull()) outputSize = size();
+    return new TiledExport(_data, file, outputSize, parent);
+}
+
 void PdfDocument::copyImageToClipboard(QSize outputSize)
 {
     QImage img = asImage(outputSize);
@@ -74,11 +153,11 @@ void PdfDocument::copyImageToClipboard(QSize outputSize)
     }
 }
 
-QImage PdfDocument::asImage(QSize outputSize)
+QImage PdfDocument::asImage(QSize outputSize, int page)
 {
-    if (!isValid()) return QImage();
-    if (outputSize.isNull()) outputSize = size();
-    QImage qimg = _doc1->render(0, outputSize);
+    if (!isValid() || page >= pageCount()) return QImage();
+    if (outputSize.isNull()) outputSize = size(page);
+    QImage qimg = _doc1->render(page, outputSize);
     return qimg;
 }
 
@@ -100,14 +179,17 @@ QImage PdfDocument::asImage(QSize outputSize)
 //    _doc->setRenderBackend(backend);
 //}
 
-QSize PdfDocument::size()
+QSize PdfDocument::size(int page)
 {
     if (isValid()) {
-        QSizeF sizef = _doc1->pagePointSize(0);
+        QSizeF sizef = _doc1->pagePointSize(page);
         return QSize(static_cast<int>(sizef.width()), static_cast<int>(sizef.height()));
     } else {
         return QSize();
     }
 }
 
-
+int PdfDocument::pageCount()
+{
+    return _doc1->pageCount();
+}
@@ -5,23 +5,68 @@
 #include <QString>
 #include <QLabel>
 #include <QPdfDocument>
+#include <QThread>
+#include <QList>
+#include <QImage>
+
+#include "pdfrenderer.h"
+#include "tiledexport.h"
+
+// how many renderings at different sizes are kept for redisplay
+#define PDF_RENDER_CACHE_SIZE 6
 
 class PdfDocument : public QObject
 {
     Q_OBJECT
 public:
     explicit PdfDocument(QString file, QObject *parent = nullptr);
+    ~PdfDocument() override;
+
+    /*!
+     * \brief renderTo shows the page in the given label, scaled to fit in rect. If
+     * the page hasn't been rendered at that size before, the closest earlier
+     * rendering is scaled to fit for now, and a sharp rendering is made in the
+     * background, replacing it when it is done.
+     */
     void renderTo(QLabel *label, QRect rect);
     bool isValid();
 //    void exportToSvg(QString file, QSize size);
-    bool exportImage(QString file, const char *format, QSize outputSize=QSize());
+    bool exportImage(QString file, const char *format, QSize outputSize=QSize(), int page=0);
     bool exportPdf(QString file);
+
+    /*!
+     * \brief exportTiff prepares to write the page as a TIFF image in the background,
+     * rendering it in bands so that even very large images don't need much memory.
+     * Returns the export, to be started by the caller, or nullptr if there is no
+     * valid page.
+     */
+    TiledExport *exportTiff(QString file, QSize outputSize=QSize(), QObject *parent=nullptr);
     void copyImageToClipboard(QSize outputSize=QSize());
-    QImage asImage(QSize outputSize=QSize());
-    QSize size();
+    QImage asImage(QSize outputSize=QSize(), int page=0);
+    QSize size(int page=0);
+    int pageCount();
+
+signals:
+    void renderRequested(int id, QSize size);
+
+private slots:
+    void pageRendered(int id, QSize size, QImage image);
+
 private:
+    void showImage(QImage image, QSize size);
+
     QPdfDocument *_doc1;
     QByteArray _data;
+
+    QThread _thread;
+    PdfRenderer *_renderer;
+    int _requestId;
+    QLabel *_label;
+    qreal _ratio;
+    QSize _target;
+
+    // earlier renderings, most recently used first
+    QList<QImage> _renders;
 };
 
 #endif // PDFDOCUMENT_H
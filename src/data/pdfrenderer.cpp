@@ -0,0 +1,49 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "pdfrenderer.h"
+
+#include <QPdfDocument>
+
+PdfRenderer::PdfRenderer(QByteArray data, QObject *parent) :
+    QObject(parent), _data(data), _latest(0)
+{
+    _doc = nullptr;
+}
+
+void PdfRenderer::cancelBefore(int id)
+{
+    _latest.storeRelease(id);
+}
+
+void PdfRenderer::render(int id, QSize size)
+{
+    if (id < _latest.loadAcquire()) return;
+
+    // load the document in the rendering thread, the first time it is needed
+    if (_doc == nullptr) {
+        _doc = new QPdfDocument(this);
+        _buffer.setData(_data);
+        _buffer.open(QIODevice::ReadOnly);
+        _doc->load(&_buffer);
+    }
+
+    if (_doc->pageCount() == 0) return;
+    QImage img = _doc->render(0, size);
+    emit rendered(id, size, img);
+}
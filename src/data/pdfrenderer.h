@@ -0,0 +1,63 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*!
+ * Renders the first page of a PDF in a background thread. The renderer keeps
+ * its own copy of the document, since a QPdfDocument can't be shared between
+ * threads. Requests are numbered, and a request is skipped if a newer one has
+ * been made before it is started.
+ */
+
+#ifndef PDFRENDERER_H
+#define PDFRENDERER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QBuffer>
+#include <QImage>
+#include <QSize>
+#include <QAtomicInt>
+
+class QPdfDocument;
+
+class PdfRenderer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PdfRenderer(QByteArray data, QObject *parent = nullptr);
+
+    /*!
+     * \brief cancelBefore drops every request older than the given one which has
+     * not been started yet. This can be called from any thread.
+     */
+    void cancelBefore(int id);
+
+public slots:
+    void render(int id, QSize size);
+
+signals:
+    void rendered(int id, QSize size, QImage image);
+
+private:
+    QByteArray _data;
+    QBuffer _buffer;
+    QPdfDocument *_doc;
+    QAtomicInt _latest;
+};
+
+#endif // PDFRENDERER_H
@@ -0,0 +1,85 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "sourcemap.h"
+
+SourceMap::SourceMap()
+{
+}
+
+void SourceMap::clear()
+{
+    _spans.clear();
+    _nodeSpans.clear();
+    _edgeSpans.clear();
+}
+
+void SourceMap::addNode(Node *n, int start, int end)
+{
+    Span s = { start, end, n, nullptr };
+    _nodeSpans.insert(n, _spans.size());
+    _spans << s;
+}
+
+void SourceMap::addEdge(Edge *e, int start, int end)
+{
+    Span s = { start, end, nullptr, e };
+    _edgeSpans.insert(e, _spans.size());
+    _spans << s;
+}
+
+QPair<int,int> SourceMap::nodeRange(Node *n) const
+{
+    int i = _nodeSpans.value(n, -1);
+    if (i == -1) return QPair<int,int>(-1,-1);
+    return QPair<int,int>(_spans[i].start, _spans[i].end);
+}
+
+QPair<int,int> SourceMap::edgeRange(Edge *e) const
+{
+    int i = _edgeSpans.value(e, -1);
+    if (i == -1) return QPair<int,int>(-1,-1);
+    return QPair<int,int>(_spans[i].start, _spans[i].end);
+}
+
+Node *SourceMap::nodeAt(int pos) const
+{
+    int i = spanAt(pos);
+    return (i == -1) ? nullptr : _spans[i].node;
+}
+
+Edge *SourceMap::edgeAt(int pos) const
+{
+    int i = spanAt(pos);
+    return (i == -1) ? nullptr : _spans[i].edge;
+}
+
+int SourceMap::spanAt(int pos) const
+{
+    // find the last span starting at or before pos
+    int lo = 0;
+    int hi = _spans.size();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (_spans[mid].start <= pos) lo = mid + 1;
+        else hi = mid;
+    }
+
+    if (lo == 0 || pos > _spans[lo - 1].end) return -1;
+    return lo - 1;
+}
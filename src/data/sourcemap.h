@@ -0,0 +1,81 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*!
+ * A map between the nodes and edges of a Graph and the character ranges of the
+ * code that Graph::tikz() produced for them. Ranges are recorded in the order
+ * the code is written, so they are sorted and disjoint, and the element at a
+ * given position in the code can be found by binary search.
+ *
+ * The map refers to elements by pointer, so it is only meaningful for the code
+ * from the most recent call to Graph::tikz().
+ */
+
+#ifndef SOURCEMAP_H
+#define SOURCEMAP_H
+
+#include <QHash>
+#include <QPair>
+#include <QVector>
+
+class Node;
+class Edge;
+
+class SourceMap
+{
+public:
+    SourceMap();
+    void clear();
+
+    /*!
+     * \brief addNode records that the code for the given node occupies the
+     * characters from start up to (but not including) end. Ranges must be added
+     * in increasing order.
+     */
+    void addNode(Node *n, int start, int end);
+    void addEdge(Edge *e, int start, int end);
+
+    /*!
+     * \brief nodeRange returns the range of characters of the given node, or
+     * (-1,-1) if the node has no code in the map.
+     */
+    QPair<int,int> nodeRange(Node *n) const;
+    QPair<int,int> edgeRange(Edge *e) const;
+
+    /*!
+     * \brief nodeAt returns the node whose code contains the given position,
+     * counting the position just after its last character, or 0 if there is none.
+     */
+    Node *nodeAt(int pos) const;
+    Edge *edgeAt(int pos) const;
+
+private:
+    struct Span {
+        int start;
+        int end;
+        Node *node;
+        Edge *edge;
+    };
+    int spanAt(int pos) const;
+
+    QVector<Span> _spans;
+    QHash<Node*,int> _nodeSpans;
+    QHash<Edge*,int> _edgeSpans;
+};
+
+#endif // SOURCEMAP_H
@@ -39,4 +39,9 @@ struct noderef {
 
 inline int isatty(int) { return 0; }
 
+// defined in tikzlexer.l
+int tikzlexer_start_condition(void *scanner);
+void tikzlexer_set_start_condition(void *scanner, int condition);
+void tikzlexer_token_range(void *scanner, int *start, int *end);
+
 #endif // TIKZPARSERDEFS_H
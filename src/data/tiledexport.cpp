@@ -0,0 +1,265 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "tiledexport.h"
+
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QImage>
+#include <QBuffer>
+#include <QFile>
+#include <QDataStream>
+#include <QVector>
+#include <QPdfDocument>
+#include <QPdfDocumentRenderOptions>
+
+// field types of TIFF directory entries
+#define TIFF_SHORT 3
+#define TIFF_LONG 4
+
+namespace {
+
+// renders the bands of a page from top to bottom, waiting whenever the queue
+// of finished bands is full
+class BandRenderer : public QThread
+{
+public:
+    BandRenderer(QByteArray pdf, QSize size, int bandRows) :
+        _pdf(pdf), _size(size), _bandRows(bandRows), _done(false), _cancelled(false) {}
+
+    // the next band, or a null image if there are no more or rendering failed
+    QImage next()
+    {
+        QMutexLocker lock(&_mutex);
+        while (_bands.isEmpty() && !_done) _notEmpty.wait(&_mutex);
+        if (_bands.isEmpty()) return QImage();
+        QImage band = _bands.dequeue();
+        _notFull.wakeOne();
+        return band;
+    }
+
+    void cancel()
+    {
+        QMutexLocker lock(&_mutex);
+        _cancelled = true;
+        _notFull.wakeOne();
+    }
+
+protected:
+    void run() override
+    {
+        // QPdfDocument can't be shared between threads, so this one has its own
+        QPdfDocument doc;
+        QBuffer buffer(&_pdf);
+        buffer.open(QIODevice::ReadOnly);
+        doc.load(&buffer);
+
+        for (int y = 0; y < _size.height() && doc.pageCount() > 0; y += _bandRows) {
+            int rows = qMin(_bandRows, _size.height() - y);
+            QPdfDocumentRenderOptions opts;
+            opts.setScaledSize(_size);
+            opts.setScaledClipRect(QRect(0, y, _size.width(), rows));
+            QImage band = doc.render(0, QSize(_size.width(), rows), opts);
+            if (band.isNull()) break;
+            band = band.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+
+            QMutexLocker lock(&_mutex);
+            while (_bands.size() >= TILED_EXPORT_QUEUE && !_cancelled) _notFull.wait(&_mutex);
+            if (_cancelled) break;
+            _bands.enqueue(band);
+            _notEmpty.wakeOne();
+        }
+
+        QMutexLocker lock(&_mutex);
+        _done = true;
+        _notEmpty.wakeOne();
+    }
+
+private:
+    QByteArray _pdf;
+    QSize _size;
+    int _bandRows;
+    QMutex _mutex;
+    QWaitCondition _notEmpty;
+    QWaitCondition _notFull;
+    QQueue<QImage> _bands;
+    bool _done;
+    bool _cancelled;
+};
+
+// appends one row of bytes to out, compressed with the PackBits scheme
+void packBits(const uchar *row, int len, QByteArray &out)
+{
+    int i = 0;
+    while (i < len) {
+        int run = 1;
+        while (i + run < len && run < 128 && row[i + run] == row[i]) ++run;
+
+        if (run >= 2) {
+            out.append(static_cast<char>(1 - run));
+            out.append(static_cast<char>(row[i]));
+            i += run;
+        } else {
+            // copy bytes literally, up to the start of the next run
+            int start = i++;
+            while (i < len && i - start < 128 && !(i + 1 < len && row[i] == row[i + 1])) ++i;
+            out.append(static_cast<char>(i - start - 1));
+            out.append(reinterpret_cast<const char*>(row + start), i - start);
+        }
+    }
+}
+
+void writeEntry(QDataStream &out, quint16 tag, quint16 type, quint32 count, quint32 value)
+{
+    out << tag << type << count << value;
+}
+
+}
+
+TiledExport::TiledExport(QByteArray pdf, QString file, QSize outputSize, QObject *parent) :
+    QThread(parent), _pdf(pdf), _file(file), _outputSize(outputSize), _succeeded(false),
+    _cancelled(0)
+{
+}
+
+QString TiledExport::file() const
+{
+    return _file;
+}
+
+QSize TiledExport::outputSize() const
+{
+    return _outputSize;
+}
+
+bool TiledExport::succeeded() const
+{
+    return _succeeded;
+}
+
+bool TiledExport::wasCancelled() const
+{
+    return _cancelled.loadAcquire() != 0;
+}
+
+void TiledExport::cancel()
+{
+    _cancelled.storeRelease(1);
+}
+
+void TiledExport::run()
+{
+    _succeeded = exportTiff();
+}
+
+bool TiledExport::exportTiff()
+{
+    if (_outputSize.isEmpty()) return false;
+
+    QFile f(_file);
+    if (!f.open(QIODevice::WriteOnly)) return false;
+    QDataStream out(&f);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    // header, with the offset of the directory filled in at the end
+    out.writeRawData("II", 2);
+    out << quint16(42) << quint32(0);
+
+    int rowBytes = _outputSize.width() * 4;
+    int bandRows = qMax(1, TILED_EXPORT_BAND_BYTES / rowBytes);
+    BandRenderer renderer(_pdf, _outputSize, bandRows);
+    renderer.start();
+
+    // each band is written as one strip
+    QVector<quint32> offsets;
+    QVector<quint32> counts;
+    int rows = 0;
+    bool ok = true;
+    while (rows < _outputSize.height()) {
+        QImage band = renderer.next();
+        if (band.isNull() || wasCancelled()) {
+            ok = false;
+            break;
+        }
+
+        QByteArray strip;
+        for (int y = 0; y < band.height(); ++y) packBits(band.constScanLine(y), rowBytes, strip);
+
+        // a classic TIFF file can't be larger than 4GB
+        if (f.pos() + strip.size() > 0xFFFFFFF0ll) {
+            ok = false;
+            break;
+        }
+
+        offsets << static_cast<quint32>(f.pos());
+        counts << static_cast<quint32>(strip.size());
+        out.writeRawData(strip.constData(), strip.size());
+        rows += band.height();
+        emit progress(rows);
+    }
+
+    renderer.cancel();
+    renderer.wait();
+    if (!ok) {
+        f.close();
+        f.remove();
+        return false;
+    }
+
+    // values that don't fit in a directory entry
+    if (f.pos() % 2 == 1) out << quint8(0);
+    quint32 bitsOffset = static_cast<quint32>(f.pos());
+    out << quint16(8) << quint16(8) << quint16(8) << quint16(8);
+    quint32 offsetsOffset = static_cast<quint32>(f.pos());
+    foreach (quint32 o, offsets) out << o;
+    quint32 countsOffset = static_cast<quint32>(f.pos());
+    foreach (quint32 c, counts) out << c;
+
+    // a single strip is stored directly in its entry
+    quint32 strips = static_cast<quint32>(offsets.size());
+    if (strips == 1) {
+        offsetsOffset = offsets[0];
+        countsOffset = counts[0];
+    }
+
+    quint32 dirOffset = static_cast<quint32>(f.pos());
+    out << quint16(11);
+    writeEntry(out, 256, TIFF_LONG, 1, static_cast<quint32>(_outputSize.width())); // ImageWidth
+    writeEntry(out, 257, TIFF_LONG, 1, static_cast<quint32>(_outputSize.height())); // ImageLength
+    writeEntry(out, 258, TIFF_SHORT, 4, bitsOffset); // BitsPerSample
+    writeEntry(out, 259, TIFF_SHORT, 1, 32773); // Compression = PackBits
+    writeEntry(out, 262, TIFF_SHORT, 1, 2); // Photometric = RGB
+    writeEntry(out, 273, TIFF_LONG, strips, offsetsOffset); // StripOffsets
+    writeEntry(out, 277, TIFF_SHORT, 1, 4); // SamplesPerPixel
+    writeEntry(out, 278, TIFF_LONG, 1, static_cast<quint32>(bandRows)); // RowsPerStrip
+    writeEntry(out, 279, TIFF_LONG, strips, countsOffset); // StripByteCounts
+    writeEntry(out, 284, TIFF_SHORT, 1, 1); // PlanarConfiguration = chunky
+    writeEntry(out, 338, TIFF_SHORT, 1, 1); // ExtraSamples = premultiplied alpha
+    out << quint32(0);
+
+    f.seek(4);
+    out << dirOffset;
+
+    ok = (out.status() == QDataStream::Ok);
+    f.close();
+    if (!ok) f.remove();
+    return ok;
+}
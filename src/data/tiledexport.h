@@ -0,0 +1,94 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*!
+ * Exports a PDF page as a TIFF image of any size, without ever holding the
+ * whole image in memory. The export runs on its own thread, so the GUI stays
+ * responsive and can show its progress. The page is rendered in horizontal
+ * bands by a second thread, while the bands that are ready are compressed and
+ * written out. At most TILED_EXPORT_QUEUE + 2 bands of at most
+ * TILED_EXPORT_BAND_BYTES each are held at a time: the queued ones, one being
+ * rendered (waiting for room in the queue) and one being compressed, along with
+ * the compressed strip of the latter.
+ */
+
+#ifndef TILEDEXPORT_H
+#define TILEDEXPORT_H
+
+#include <QByteArray>
+#include <QString>
+#include <QSize>
+#include <QThread>
+#include <QAtomicInt>
+
+// the largest band of the image that is rendered at once
+#define TILED_EXPORT_BAND_BYTES (16 * 1024 * 1024)
+
+// how many rendered bands may be waiting to be written
+#define TILED_EXPORT_QUEUE 2
+
+class TiledExport : public QThread
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief TiledExport prepares to render the first page of the given PDF to a
+     * TIFF file. The export begins when the thread is started.
+     * \param pdf the contents of the PDF file
+     * \param file the TIFF file to write
+     * \param outputSize the size of the image, in pixels
+     */
+    TiledExport(QByteArray pdf, QString file, QSize outputSize, QObject *parent = nullptr);
+
+    QString file() const;
+    QSize outputSize() const;
+
+    /*!
+     * \brief succeeded returns true once the whole file has been written
+     */
+    bool succeeded() const;
+    bool wasCancelled() const;
+
+public slots:
+    /*!
+     * \brief cancel stops the export after the band being written, and removes
+     * the partial file. Safe to call from any thread.
+     */
+    void cancel();
+
+signals:
+    /*!
+     * \brief progress is emitted, from the export thread, after each band is
+     * written, with the number of rows of the image done so far.
+     */
+    void progress(int rows);
+
+protected:
+    void run() override;
+
+private:
+    bool exportTiff();
+
+    QByteArray _pdf;
+    QString _file;
+    QSize _outputSize;
+    bool _succeeded;
+    QAtomicInt _cancelled;
+};
+
+#endif // TILEDEXPORT_H
@@ -0,0 +1,179 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*!
+ * Fractional ordering keys for the elements of a list, such as the nodes or
+ * edges of a Graph. Keys increase along the list, so they can be used directly
+ * as z-values. When elements are inserted or moved, only those elements get new
+ * keys, chosen between the keys of their new neighbours, so the rest of the list
+ * never needs renumbering unless keys become too dense.
+ *
+ * Keys of elements that have been removed from the list are simply left behind;
+ * they are dropped the next time the keys are assigned afresh.
+ */
+
+#ifndef ZORDER_H
+#define ZORDER_H
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+// smallest gap allowed between neighbouring keys before a full renumbering is needed
+#define ZORDER_MIN_GAP 0.0001
+
+template <class T>
+class ZOrder
+{
+public:
+    ZOrder() : _min(0.0), _max(-1.0) {}
+
+    /*!
+     * \brief assign gives the elements of the list the keys 0, 1, 2, ...
+     */
+    void assign(const QVector<T*> &order)
+    {
+        _keys.clear();
+        _keys.reserve(order.size());
+        for (int i = 0; i < order.size(); ++i) _keys.insert(order[i], i);
+        _min = 0.0;
+        _max = order.size() - 1.0;
+    }
+
+    /*!
+     * \brief key returns the key of the given element. Elements without a key are
+     * treated as being at the end of the list.
+     */
+    qreal key(T *t) const
+    {
+        return _keys.value(t, _max + 1.0);
+    }
+
+    /*!
+     * \brief place gives new keys to the elements at the given (ascending) positions
+     * of the list, which have just been inserted or moved there. The keys of all
+     * other elements must already be in order. Returns false if there is no room
+     * between the neighbouring keys, in which case the caller should assign() the
+     * keys afresh.
+     */
+    bool place(const QVector<T*> &order, const QVector<int> &indices)
+    {
+        int i = 0;
+        while (i < indices.size()) {
+            // find a run of consecutive positions
+            int j = i;
+            while (j + 1 < indices.size() && indices[j + 1] == indices[j] + 1) ++j;
+
+            int first = indices[i];
+            int last = indices[j];
+            int len = j - i + 1;
+            bool hasPrev = first > 0;
+            bool hasNext = last + 1 < order.size();
+            qreal prev = hasPrev ? key(order[first - 1]) : 0.0;
+            qreal next = hasNext ? key(order[last + 1]) : 0.0;
+
+            qreal start, step;
+            if (hasPrev && hasNext) {
+                step = (next - prev) / (len + 1);
+                if (step < ZORDER_MIN_GAP) return false;
+                start = prev + step;
+            } else if (hasPrev) {
+                step = 1.0;
+                start = prev + 1.0;
+            } else if (hasNext) {
+                step = 1.0;
+                start = next - len;
+            } else {
+                step = 1.0;
+                start = 0.0;
+            }
+
+            for (int k = 0; k < len; ++k) {
+                qreal z = start + k * step;
+                _keys.insert(order[first + k], z);
+                if (z < _min) _min = z;
+                if (z > _max) _max = z;
+            }
+
+            i = j + 1;
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief delta computes which elements move between two orderings of the same
+     * elements. The elements forming a longest increasing subsequence (by old
+     * position, taken in the new order) keep their relative order, so only the rest
+     * are returned: oldMoved/oldIndices give them at their old (ascending) positions
+     * and newMoved/newIndices at their new ones.
+     */
+    static void delta(const QVector<T*> &oldOrder, const QVector<T*> &newOrder,
+                      QVector<T*> &oldMoved, QVector<int> &oldIndices,
+                      QVector<T*> &newMoved, QVector<int> &newIndices)
+    {
+        QHash<T*,int> oldPos;
+        for (int i = 0; i < oldOrder.size(); ++i) oldPos.insert(oldOrder[i], i);
+
+        int n = newOrder.size();
+        QVector<int> seq(n);
+        for (int i = 0; i < n; ++i) seq[i] = oldPos.value(newOrder[i]);
+
+        // patience sorting: tails[k] is the end of the best increasing run of length k+1
+        QVector<int> tails;
+        QVector<int> prev(n, -1);
+        for (int i = 0; i < n; ++i) {
+            int lo = 0;
+            int hi = tails.size();
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (seq[tails[mid]] < seq[i]) lo = mid + 1;
+                else hi = mid;
+            }
+            if (lo > 0) prev[i] = tails[lo - 1];
+            if (lo == tails.size()) tails << i;
+            else tails[lo] = i;
+        }
+
+        QVector<bool> kept(n, false);
+        for (int i = tails.isEmpty() ? -1 : tails.last(); i != -1; i = prev[i]) kept[i] = true;
+
+        QSet<T*> moved;
+        for (int i = 0; i < n; ++i) {
+            if (!kept[i]) {
+                newMoved << newOrder[i];
+                newIndices << i;
+                moved << newOrder[i];
+            }
+        }
+
+        for (int i = 0; i < oldOrder.size(); ++i) {
+            if (moved.contains(oldOrder[i])) {
+                oldMoved << oldOrder[i];
+                oldIndices << i;
+            }
+        }
+    }
+
+private:
+    QHash<T*,qreal> _keys;
+    qreal _min;
+    qreal _max;
+};
+
+#endif // ZORDER_H
@@ -18,6 +18,7 @@
 
 #include "tikzit.h"
 #include "edgeitem.h"
+#include "util.h"
 
 #include <QPainterPath>
 #include <QPen>
@@ -25,6 +26,8 @@
 EdgeItem::EdgeItem(Edge *edge)
 {
     _edge = edge;
+    _shapeDirty = true;
+    _curved = false;
     setFlag(QGraphicsItem::ItemIsSelectable);
 
     _cp1Item = new QGraphicsEllipseItem(this);
@@ -48,15 +51,19 @@ void EdgeItem::readPos()
     _edge->updateControls();
     QPainterPath path;
 
-    path.moveTo (toScreen(_edge->tail()));
+    _c0 = toScreen(_edge->tail());
+    _c1 = toScreen(_edge->cp1());
+    _c2 = toScreen(_edge->cp2());
+    _c3 = toScreen(_edge->head());
+    _curved = (_edge->bend() != 0 || !_edge->basicBendMode());
 
-	if (_edge->bend() != 0 || !_edge->basicBendMode()) {
-		path.cubicTo(toScreen(_edge->cp1()),
-			toScreen(_edge->cp2()),
-			toScreen(_edge->head()));
+    path.moveTo (_c0);
+
+	if (_curved) {
+		path.cubicTo(_c1, _c2, _c3);
 	}
 	else {
-		path.lineTo(toScreen(_edge->head()));
+		path.lineTo(_c3);
 	}
     
     setPath(path);
@@ -68,6 +75,9 @@ void EdgeItem::readPos()
 void EdgeItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *)
 {
     //QGraphicsPathItem::paint(painter, option, widget);
+    bool fast = scene() && static_cast<TikzScene*>(scene())->fastRendering();
+    painter->setRenderHint(QPainter::Antialiasing, !fast);
+
 	QPen pen = _edge->style()->pen();
 	painter->setPen(pen);
     painter->setBrush(Qt::NoBrush);
@@ -162,7 +172,7 @@ void EdgeItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidge
         painter->drawLine(toScreen(_edge->tail()), toScreen(_edge->cp1()));
         painter->drawLine(toScreen(_edge->head()), toScreen(_edge->cp2()));
 
-        if (scene()) {
+        if (scene() && !fast) {
             TikzScene *sc = static_cast<TikzScene*>(scene());
 
             painter->setFont(Tikzit::LABEL_FONT);
@@ -208,14 +218,70 @@ QRectF EdgeItem::boundingRect() const
 
 QPainterPath EdgeItem::shape() const
 {
+    if (_shapeDirty) {
+        // get the shape of the edge, and expand a bit to make selection easier
+        QPainterPathStroker stroker;
+        stroker.setWidth(EDGE_SELECT_WIDTH);
+        stroker.setJoinStyle(Qt::MiterJoin);
+        _expPath = stroker.createStroke(_path).simplified();
+        _shapeDirty = false;
+    }
+
     return _expPath;
 }
 
+bool EdgeItem::contains(const QPointF &point) const
+{
+    qreal r = EDGE_SELECT_WIDTH / 2.0;
+
+    // the curve lies inside the hull of its control points
+    QRectF hull = QRectF(_c0, _c3).normalized();
+    if (_curved) {
+        hull = hull.united(QRectF(_c1, _c2).normalized());
+    }
+    if (!hull.adjusted(-r,-r,r,r).contains(point)) return false;
+
+    qreal dist = _curved ? distanceToBezier(point, _c0, _c1, _c2, _c3, 0.25)
+                         : distanceToSegment(point, _c0, _c3);
+    return dist <= r;
+}
+
 Edge *EdgeItem::edge() const
 {
     return _edge;
 }
 
+QVariant EdgeItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    // report selection changes to the scene, which tracks the selected edges
+    if (change == ItemSelectedHasChanged && scene()) {
+        static_cast<TikzScene*>(scene())->edgeSelectionChanged(_edge, value.toBool());
+    } else if (change == ItemSceneChange && scene()) {
+        TikzScene::markItemDirty(this);
+        if (isSelected()) static_cast<TikzScene*>(scene())->edgeSelectionChanged(_edge, false);
+    } else if (change == ItemSceneHasChanged && scene()) {
+        TikzScene::markItemDirty(this);
+        if (isSelected()) static_cast<TikzScene*>(scene())->edgeSelectionChanged(_edge, true);
+    } else if (change == ItemZValueHasChanged) {
+        TikzScene::markItemDirty(this);
+    }
+
+    return QGraphicsItem::itemChange(change, value);
+}
+
+void EdgeItem::setEdge(Edge *edge)
+{
+    // keep the scene's selection in terms of the new edge
+    if (isSelected() && scene()) {
+        TikzScene *sc = static_cast<TikzScene*>(scene());
+        sc->edgeSelectionChanged(_edge, false);
+        sc->edgeSelectionChanged(edge, true);
+    }
+
+    _edge = edge;
+    readPos();
+}
+
 QGraphicsEllipseItem *EdgeItem::cp1Item() const
 {
     return _cp1Item;
@@ -233,18 +299,15 @@ QPainterPath EdgeItem::path() const
 
 void EdgeItem::setPath(const QPainterPath &path)
 {
+    TikzScene::markItemDirty(this);
 	prepareGeometryChange();
 
 	_path = path;
-
-    // get the shape of the edge, and expand a bit to make selection easier
-    QPainterPathStroker stroker;
-    stroker.setWidth(8);
-    stroker.setJoinStyle(Qt::MiterJoin);
-    _expPath = stroker.createStroke(_path).simplified();
+    _shapeDirty = true;
 
     float r = GLOBAL_SCALEF * (_edge->cpDist() + 0.2);
     _boundingRect = _path.boundingRect().adjusted(-r,-r,r,r);
+    TikzScene::markItemDirty(this);
 
     update();
 }
@@ -33,6 +33,9 @@
 #include <QGraphicsEllipseItem>
 #include <QString>
 
+// width of the band around an edge that counts as clicking on it, in screen coordinates
+#define EDGE_SELECT_WIDTH 8.0
+
 class EdgeItem : public QGraphicsItem
 {
 public:
@@ -40,8 +43,21 @@ public:
     void readPos();
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) override;
     QRectF boundingRect() const override;
+
+    /*!
+     * \brief shape returns the stroked outline of the edge. This is expensive to build,
+     * so it is only computed on demand, the first time it is needed after the edge moves.
+     */
     QPainterPath shape() const override;
+
+    /*!
+     * \brief contains tests whether a point is within EDGE_SELECT_WIDTH/2 of the curve
+     * directly, without building the stroked shape.
+     */
+    bool contains(const QPointF &point) const override;
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
     Edge *edge() const;
+    void setEdge(Edge *edge);
     QGraphicsEllipseItem *cp1Item() const;
     QGraphicsEllipseItem *cp2Item() const;
 
@@ -53,7 +69,10 @@ public:
 private:
     Edge *_edge;
     QPainterPath _path;
-    QPainterPath _expPath;
+    mutable QPainterPath _expPath;
+    mutable bool _shapeDirty;
+    bool _curved;
+    QPointF _c0, _c1, _c2, _c3;
     QRectF _boundingRect;
     QGraphicsEllipseItem *_cp1Item;
     QGraphicsEllipseItem *_cp2Item;
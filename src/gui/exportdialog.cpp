@@ -66,6 +66,7 @@ ExportDialog::ExportDialog(QWidget *parent) :
         case PNG: suffix = ".png"; break;
         case JPG: suffix = ".jpg"; break;
         case PDF: suffix = ".pdf"; break;
+        case TIFF: suffix = ".tif"; break;
     }
 
     QString fileName;
@@ -151,6 +152,7 @@ void ExportDialog::on_browseButton_clicked()
         case PNG: suffix = "png"; break;
         case JPG: suffix = "jpg"; break;
         case PDF: suffix = "pdf"; break;
+        case TIFF: suffix = "tif"; break;
     }
 
     QFileDialog dialog;
@@ -187,6 +189,7 @@ void ExportDialog::on_fileFormat_currentIndexChanged(int f)
             case PNG: path.replace(re, ".png"); break;
             case JPG: path.replace(re, ".jpg"); break;
             case PDF: path.replace(re, ".pdf"); break;
+            case TIFF: path.replace(re, ".tif"); break;
         }
 
         ui->filePath->setText(path);
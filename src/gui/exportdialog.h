@@ -17,7 +17,7 @@
 */
 
 /*!
- * A dialog for exporting a LaTeX-generated preview to PNG, JPG, or PDF.
+ * A dialog for exporting a LaTeX-generated preview to PNG, JPG, PDF, or TIFF.
  */
 
 #ifndef EXPORTDIALOG_H
@@ -39,7 +39,8 @@ public:
     enum Format {
         PNG = 0,
         JPG = 1,
-        PDF = 2
+        PDF = 2,
+        TIFF = 3
     };
     QString filePath();
     QSize size();
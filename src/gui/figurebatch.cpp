@@ -0,0 +1,188 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "figurebatch.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMessageBox>
+
+FigureBatch::FigureBatch(PreviewScheduler *scheduler, PreviewWindow *preview, QObject *parent) :
+    QObject(parent)
+{
+    _scheduler = scheduler;
+    _preview = preview;
+    _proc = nullptr;
+    _progress = nullptr;
+    _running = false;
+    _current = -1;
+    _exported = 0;
+}
+
+void FigureBatch::exportFolder(QString dir)
+{
+    if (_running) return;
+
+    _files.clear();
+    _figures.clear();
+    _retry.clear();
+    _failed.clear();
+    _errors.clear();
+    _exported = 0;
+
+    QDir d(dir);
+    foreach (QString name, d.entryList(QStringList() << "*.tikz", QDir::Files, QDir::Name)) {
+        QFile f(d.filePath(name));
+        if (!f.open(QIODevice::ReadOnly)) continue;
+        _files << f.fileName();
+        _figures << QString::fromUtf8(f.readAll());
+    }
+
+    if (_files.isEmpty()) {
+        QMessageBox::information(nullptr,
+            tr("Export Images of Folder"),
+            tr("There are no .tikz files in '%1'.").arg(QDir::toNativeSeparators(dir)));
+        emit finished();
+        return;
+    }
+
+    _running = true;
+    _progress = new QProgressDialog(tr("Typesetting %1 figures...").arg(_figures.size()),
+                                    tr("Cancel"), 0, _figures.size());
+    _progress->setWindowTitle(tr("Export Images of Folder"));
+    _progress->setMinimumDuration(0);
+    _progress->setValue(0);
+    connect(_progress, SIGNAL(canceled()), this, SLOT(cancel()));
+
+    _proc = new LatexProcess(_preview, this);
+    connect(_proc, SIGNAL(previewFinished()), this, SLOT(batchFinished()));
+    _scheduler->submit(_proc, _figures, true);
+}
+
+bool FigureBatch::isRunning() const
+{
+    return _running;
+}
+
+void FigureBatch::batchFinished()
+{
+    if (_proc == nullptr) return;
+
+    PdfDocument *doc = nullptr;
+    if (!_proc->pdf().isEmpty()) doc = new PdfDocument(_proc->pdf());
+
+    for (int i = 0; i < _figures.size(); ++i) {
+        int page = _proc->figurePage(i);
+        if (page != -1 && doc != nullptr && exportFigure(i, doc, page)) {
+            ++_exported;
+        } else {
+            _errors.insert(i, _proc->figureErrors(i));
+            _retry << i;
+        }
+    }
+
+    delete doc;
+    dropProcess();
+    runNextSingle();
+}
+
+void FigureBatch::singleFinished()
+{
+    if (_proc == nullptr) return;
+
+    bool ok = false;
+    if (!_proc->pdf().isEmpty()) {
+        PdfDocument doc(_proc->pdf());
+        ok = exportFigure(_current, &doc, 0);
+    }
+
+    if (ok) ++_exported;
+    else _failed << _current;
+
+    dropProcess();
+    runNextSingle();
+}
+
+void FigureBatch::cancel()
+{
+    if (_proc == nullptr) return;
+    _scheduler->withdraw(_proc);
+    dropProcess();
+    _retry.clear();
+    report(true);
+}
+
+void FigureBatch::dropProcess()
+{
+    // this may be called from a signal of the process, so don't delete it yet
+    disconnect(_proc, nullptr, this, nullptr);
+    _proc->deleteLater();
+    _proc = nullptr;
+}
+
+bool FigureBatch::exportFigure(int i, PdfDocument *doc, int page)
+{
+    if (!doc->isValid() || page >= doc->pageCount()) return false;
+    QFileInfo fi(_files[i]);
+    QString file = fi.absolutePath() + "/" + fi.completeBaseName() + ".png";
+    return doc->exportImage(file, "PNG", doc->size(page) * FIGURE_BATCH_SCALE, page);
+}
+
+void FigureBatch::runNextSingle()
+{
+    if (_retry.isEmpty()) {
+        report();
+        return;
+    }
+
+    _current = _retry.takeFirst();
+    _progress->setLabelText(tr("Typesetting %1 on its own...")
+                            .arg(QFileInfo(_files[_current]).fileName()));
+    _progress->setValue(_figures.size() - _retry.size() - 1);
+
+    _proc = new LatexProcess(_preview, this);
+    connect(_proc, SIGNAL(previewFinished()), this, SLOT(singleFinished()));
+    _scheduler->submit(_proc, QStringList() << _figures[_current], false);
+}
+
+void FigureBatch::report(bool cancelled)
+{
+    _running = false;
+    _current = -1;
+
+    // the dialog may be what is being cancelled, so don't delete it yet
+    disconnect(_progress, nullptr, this, nullptr);
+    _progress->hide();
+    _progress->deleteLater();
+    _progress = nullptr;
+
+    QString msg = tr("Exported %1 of %2 figures.").arg(_exported).arg(_figures.size());
+    if (cancelled) msg = tr("Export cancelled.") + " " + msg;
+    if (!_failed.isEmpty()) {
+        msg += "\n\n" + tr("Could not typeset:");
+        foreach (int i, _failed) {
+            msg += "\n" + QFileInfo(_files[i]).fileName();
+            QStringList errors = _errors.value(i);
+            if (!errors.isEmpty()) msg += ": " + errors.first();
+        }
+    }
+
+    QMessageBox::information(nullptr, tr("Export Images of Folder"), msg);
+    emit finished();
+}
@@ -0,0 +1,94 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*!
+ * Exports every figure in a folder as a PNG image. All of the figures are
+ * typeset in a single pdflatex run, with one page per figure. Figures that
+ * fail in the batch (e.g. because of an error in an earlier figure) are
+ * tried again on their own, and whatever still fails is reported, along
+ * with the errors it caused in the batch run.
+ *
+ * The runs go through the PreviewScheduler like previews do, but never show
+ * in the preview window. Progress is shown in a dialog of its own instead.
+ */
+
+#ifndef FIGUREBATCH_H
+#define FIGUREBATCH_H
+
+#include "latexprocess.h"
+#include "previewwindow.h"
+#include "previewscheduler.h"
+#include "pdfdocument.h"
+
+#include <QObject>
+#include <QProgressDialog>
+#include <QStringList>
+#include <QList>
+#include <QMap>
+
+// size of the exported images, relative to the size of the figures
+#define FIGURE_BATCH_SCALE 4
+
+class FigureBatch : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FigureBatch(PreviewScheduler *scheduler, PreviewWindow *preview,
+                         QObject *parent = nullptr);
+
+    /*!
+     * \brief exportFolder saves each *.tikz file in the given folder as a PNG image
+     * with the same name.
+     */
+    void exportFolder(QString dir);
+    bool isRunning() const;
+
+signals:
+    void finished();
+
+private slots:
+    void batchFinished();
+    void singleFinished();
+    void cancel();
+
+private:
+    bool exportFigure(int i, PdfDocument *doc, int page);
+    void runNextSingle();
+    void dropProcess();
+    void report(bool cancelled = false);
+
+    PreviewScheduler *_scheduler;
+    PreviewWindow *_preview;
+    LatexProcess *_proc;
+    QProgressDialog *_progress;
+    bool _running;
+
+    // the path and contents of each figure
+    QStringList _files;
+    QStringList _figures;
+
+    // figures to be tried again on their own, and the one being tried
+    QList<int> _retry;
+    int _current;
+
+    int _exported;
+    QList<int> _failed;
+    QMap<int,QStringList> _errors;
+};
+
+#endif // FIGUREBATCH_H
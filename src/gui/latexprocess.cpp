@@ -18,17 +18,37 @@
 
 #include "latexprocess.h"
 #include "tikzit.h"
+#include "previewcache.h"
 
 #include <QDebug>
 #include <QStandardPaths>
 #include <QTemporaryDir>
 #include <QStringList>
-#include <QSettings>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <QMap>
 
 LatexProcess::LatexProcess(PreviewWindow *preview, QObject *parent) : QObject(parent)
 {
     _preview = preview;
     _output = preview->outputTextEdit();
+    _attached = true;
+    _status = PreviewWindow::Running;
+    _elapsed = -1;
+    _figureCount = 0;
+    _droppedLines = 0;
+    _log.setCapacity(LATEX_LOG_MAX_LINES);
+    _awaitingErrorLine = false;
+    _bodyOffset = -1;
+    _buildingFormat = false;
+
+    // output is shown in batches, rather than every time a little arrives
+    _flushTimer = new QTimer(this);
+    _flushTimer->setSingleShot(true);
+    _flushTimer->setInterval(LATEX_LOG_FLUSH_INTERVAL);
+    connect(_flushTimer, SIGNAL(timeout()), this, SLOT(flushOutput()));
 
     _proc = new QProcess(this);
     _proc->setProcessChannelMode(QProcess::MergedChannels);
@@ -43,28 +63,87 @@ LatexProcess::LatexProcess(PreviewWindow *preview, QObject *parent) : QObject(pa
 
 void LatexProcess::makePreview(QString tikz)
 {
-    QSettings settings("tikzit", "tikzit");
-    _preview->setStatus(PreviewWindow::Running);
-    _output->clear();
+    _figureCount = 0;
+    start(tikz);
+}
+
+void LatexProcess::makeBatch(QStringList figures)
+{
+    // with the preview package, each figure goes on a page of its own. Around each
+    // figure, the number of pages so far is written to the log, which tells which
+    // page (if any) the figure ended up on and which errors it caused.
+    QString body;
+    QTextStream tex(&body);
+    tex << "\\makeatletter\n";
+    tex << "\\ifdefined\\ReadonlyShipoutCounter\n";
+    tex << "\\def\\tikzitpages{\\number\\ReadonlyShipoutCounter}\n";
+    tex << "\\else\n";
+    tex << "\\def\\tikzitpages{\\number\\numexpr\\c@page-1\\relax}\n";
+    tex << "\\fi\n";
+    tex << "\\makeatother\n\n";
+    _figureStarts.clear();
+    for (int i = 0; i < figures.size(); ++i) {
+        tex << "\\typeout{" BATCH_MARKER " " << i << " START \\tikzitpages}\n";
+        tex.flush();
+        _figureStarts << body.count('\n');
+        tex << figures[i] << "\n";
+        tex << "\\typeout{" BATCH_MARKER " " << i << " END \\tikzitpages}\n\n";
+    }
+    tex.flush();
+
+    _figureCount = figures.size();
+    start(body);
+}
+
+QString LatexProcess::pdf() const
+{
+    return _pdf;
+}
+
+int LatexProcess::figurePage(int i) const
+{
+    return _figurePages.value(i, -1);
+}
+
+QStringList LatexProcess::figureErrors(int i) const
+{
+    return _figureErrors.value(i);
+}
+
+void LatexProcess::start(QString tikz)
+{
+    _timer.start();
+    _log.clear();
+    _droppedLines = 0;
+    _partialLine.clear();
+    _pendingLines.clear();
+    _messages.clear();
+    _awaitingErrorLine = false;
+    _bodyOffset = -1;
+    _pdf.clear();
+    if (_attached) _output->clear();
+    showStatus(PreviewWindow::Running);
 
     if (!_workingDir.isValid()) {
-        _output->appendPlainText("COULD NOT WRITE TO TEMP DIR: " + _workingDir.path() + "\n");
+        appendOutput("COULD NOT WRITE TO TEMP DIR: " + _workingDir.path() + "\n");
+        showStatus(PreviewWindow::Failed);
+        emit previewFinished();
         return;
     }
 
-    _output->appendPlainText("USING TEMP DIR: " + _workingDir.path() + "\n");
+    appendOutput("USING TEMP DIR: " + _workingDir.path() + "\n");
 
     QString pdflatex;
 
-    if (settings.value("auto-detect-pdflatex", true).toBool()) {
-        _output->appendPlainText("SEARCHING FOR pdflatex IN:");
-        _output->appendPlainText(qgetenv("PATH"));
-        _output->appendPlainText("\n");
+    if (tikzit->preferences()->autoDetectPdflatex()) {
+        appendOutput("SEARCHING FOR pdflatex IN:");
+        appendOutput(qgetenv("PATH"));
+        appendOutput("\n");
         pdflatex = QStandardPaths::findExecutable("pdflatex");
         if (pdflatex.isEmpty()) {
             // if pdflatex is not in PATH, we are probably on mac or windows, so try common
             // install directories.
-            _output->appendPlainText("NOT FOUND IN PATH, TRYING:");
+            appendOutput("NOT FOUND IN PATH, TRYING:");
 
             QStringList texDirs;
             // common macOS tex directories:
@@ -81,89 +160,525 @@ void LatexProcess::makePreview(QString tikz)
             texDirs << "C:\\Program Files\\MiKTeX 2.7\\miktex\\bin";
             texDirs << "C:\\Program Files\\MiKTeX 2.7\\miktex\\bin\\x64";
 
-            _output->appendPlainText(texDirs.join(":"));
+            appendOutput(texDirs.join(":"));
             pdflatex = QStandardPaths::findExecutable("pdflatex", texDirs);
         }
 
         if (pdflatex.isEmpty()) {
-            _output->appendPlainText("pdflatex NOT FOUND, ABORTING.\n");
-            _preview->setStatus(PreviewWindow::Failed);
+            appendOutput("pdflatex NOT FOUND, ABORTING.\n");
+            showStatus(PreviewWindow::Failed);
+            emit previewFinished();
             return;
         } else {
-            _output->appendPlainText("FOUND: " + pdflatex + "\n");
+            appendOutput("FOUND: " + pdflatex + "\n");
         }
     } else {
-        _output->appendPlainText("USING pdflatex:\n");
-        pdflatex = settings.value("pdflatex-path", "/usr/bin/pdflatex").toString();
-        _output->appendPlainText(pdflatex + "\n");
+        appendOutput("USING pdflatex:\n");
+        pdflatex = tikzit->preferences()->pdflatexPath();
+        if (pdflatex.isEmpty()) pdflatex = "/usr/bin/pdflatex";
+        appendOutput(pdflatex + "\n");
     }
 
-    // copy tikzit.sty to preview dir
-    QFile::copy(":/tex/sample/tikzit.sty", _workingDir.path() + "/tikzit.sty");
+    _pdflatex = pdflatex;
+    _tikz = tikz;
+    _figurePages.clear();
+    _figureErrors.clear();
 
-    // write out the file containing the tikz picture
-    QFile f(_workingDir.path() + "/preview.tex");
-    f.open(QIODevice::WriteOnly);
-    QTextStream tex(&f);
+    // the preamble, along with everything it depends on, determines whether the
+    // format file can be reused
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(pdflatex.toUtf8());
+
+    // files loaded by the preamble, which are copied to wherever it is compiled
+    _inputFiles.clear();
+    _inputFiles << QPair<QString,QString>(":/tex/sample/tikzit.sty", "tikzit.sty");
+    QFile sty(":/tex/sample/tikzit.sty");
+    if (sty.open(QIODevice::ReadOnly)) hash.addData(sty.readAll());
+
+    _preamble.clear();
+    QTextStream tex(&_preamble);
     tex << "\\documentclass{article}\n";
     tex << "\\usepackage{tikzit}\n";
     tex << "\\tikzstyle{every picture}=[tikzfig]\n";
     tex << "\\usepackage[graphics,active,tightpage]{preview}\n";
     tex << "\\PreviewEnvironment{tikzpicture}\n";
 
-    // copy active *.tikzstyles file to preview dir
+    // include the active *.tikzstyles file
     if (!tikzit->styleFile().isEmpty() && QFile::exists(tikzit->styleFilePath())) {
-        QFile::copy(tikzit->styleFilePath(), _workingDir.path() + "/" + tikzit->styleFile());
+        _inputFiles << QPair<QString,QString>(tikzit->styleFilePath(), tikzit->styleFile());
         tex << "\\input{" + tikzit->styleFile() + "}\n";
+        QFile style(tikzit->styleFilePath());
+        if (style.open(QIODevice::ReadOnly)) hash.addData(style.readAll());
 
-        // if there is a *.tikzdefs file with the same basename, copy and include it as well
+        // if there is a *.tikzdefs file with the same basename, include it as well
         QFileInfo fi(tikzit->styleFilePath());
         QString defFile = fi.baseName() + ".tikzdefs";
         QString defFilePath = fi.absolutePath() + "/" + defFile;
         if (QFile::exists(defFilePath)) {
-            QFile::copy(defFilePath, _workingDir.path() + "/" + defFile);
+            _inputFiles << QPair<QString,QString>(defFilePath, defFile);
             tex << "\\input{" + defFile + "}\n";
+            QFile defs(defFilePath);
+            if (defs.open(QIODevice::ReadOnly)) hash.addData(defs.readAll());
         }
     }
 
+    tex.flush();
+    hash.addData(_preamble.toUtf8());
+    _preambleKey = hash.result();
+
+    // the same picture with the same preamble always gives the same PDF
+    QCryptographicHash cacheHash(QCryptographicHash::Sha1);
+    cacheHash.addData(_preambleKey);
+    cacheHash.addData(tikz.toUtf8());
+    _cacheKey = cacheHash.result();
+
+    // a batch needs its log, which isn't cached
+    QString cached = (_figureCount == 0) ? PreviewCache::lookup(_cacheKey) : QString();
+    if (!cached.isEmpty()) {
+        appendOutput("USING CACHED PREVIEW: " + cached + "\n");
+        showPdf(cached);
+        showStatus(PreviewWindow::Success);
+        emit previewFinished();
+        return;
+    }
+
+    // if another preview is already building the format, don't wait for it
+    LatexWorker *worker = tikzit->latexWorker();
+    if (_preambleKey == worker->formatKey() || _preambleKey == worker->failedFormatKey() ||
+        worker->isBuildingFormat() || !formatDir().isValid())
+    {
+        runPreview();
+    } else {
+        buildFormat();
+    }
+}
+
+void LatexProcess::kill()
+{
+    // a run that was cut short has nothing to report. A format build carries on
+    // without this preview, so the next one can use it.
+    disconnect(_proc, nullptr, this, nullptr);
+    if (_buildingFormat) {
+        disconnect(tikzit->latexWorker(), nullptr, this, nullptr);
+        _buildingFormat = false;
+    }
+
+    // a waiting process leaves its files in the shared format directory, which
+    // can only be removed once the process has let go of them. The worker does
+    // that when the process finishes, which may be after this preview is gone.
+    if (!_warmJob.isEmpty()) {
+        tikzit->latexWorker()->discard(_proc, _warmJob);
+        _warmJob.clear();
+        _proc = new QProcess(this); // an idle stand-in, so _proc is never dangling
+        return;
+    }
+
+    if (_proc->state() != QProcess::NotRunning) _proc->kill();
+}
+
+void LatexProcess::setAttached(bool attached)
+{
+    if (attached == _attached) return;
+    _attached = attached;
+    _pendingLines.clear();
+    _flushTimer->stop();
+
+    // catch the preview window up on everything so far
+    if (_attached) {
+        QStringList lines;
+        for (int i = _log.firstIndex(); i <= _log.lastIndex(); ++i) lines << _log.at(i);
+        if (_droppedLines > 0) {
+            lines.prepend("(" + QString::number(_droppedLines) + " EARLIER LINES NOT KEPT)");
+        }
+        if (!_partialLine.isEmpty()) lines << QString::fromLocal8Bit(_partialLine);
+        _output->setPlainText(lines.join("\n"));
+        _preview->setStatus(_status, _elapsed);
+        if (_pdf.isEmpty()) _preview->clearPdf();
+        else _preview->setPdf(_pdf);
+    }
+}
+
+bool LatexProcess::isRunning() const
+{
+    return _status == PreviewWindow::Running;
+}
+
+QList<LatexMessage> LatexProcess::messages() const
+{
+    return _messages;
+}
+
+void LatexProcess::appendOutput(QString text)
+{
+    // messages of our own always start a new line
+    if (!_partialLine.isEmpty()) {
+        addLine(QString::fromLocal8Bit(_partialLine));
+        _partialLine.clear();
+    }
+    foreach (QString line, text.split('\n')) addLine(line);
+}
+
+void LatexProcess::appendProcessOutput(QByteArray output)
+{
+    // output arrives in arbitrary chunks, which may split a line or even a
+    // character, so only complete lines are decoded. The unfinished part has
+    // already been searched for a newline.
+    int start = 0;
+    int end = output.indexOf('\n');
+    if (end != -1) end += _partialLine.size();
+    _partialLine.append(output);
+
+    while (end != -1) {
+        int length = end - start;
+        if (length > 0 && _partialLine.at(end - 1) == '\r') --length;
+        addLine(QString::fromLocal8Bit(_partialLine.constData() + start, length));
+        start = end + 1;
+        end = _partialLine.indexOf('\n', start);
+    }
+    _partialLine.remove(0, start);
+}
+
+void LatexProcess::addLine(QString line)
+{
+    // once the buffer is full, each new line replaces the oldest one
+    if (_log.isFull()) ++_droppedLines;
+    _log.append(line);
+
+    parseLine(line);
+
+    if (_attached) {
+        _pendingLines << line;
+        if (!_flushTimer->isActive()) _flushTimer->start();
+    }
+}
+
+void LatexProcess::parseLine(QString line)
+{
+    static QRegularExpression warning("^(LaTeX|Package \\S+|Class \\S+) Warning: (.*)$");
+    static QRegularExpression badBox("^(Overfull|Underfull) \\\\[hv]box");
+    static QRegularExpression inputLine("input line (\\d+)");
+    static QRegularExpression errorLine("^l\\.(\\d+)");
+
+    if (line.startsWith("! ")) {
+        LatexMessage msg;
+        msg.type = LatexMessage::Error;
+        msg.text = line.mid(2);
+        msg.line = -1;
+        _messages << msg;
+        _awaitingErrorLine = true;
+        return;
+    }
+
+    // the line an error was found on follows the error, after some context
+    QRegularExpressionMatch m = errorLine.match(line);
+    if (_awaitingErrorLine && m.hasMatch() && _messages.last().type == LatexMessage::Error) {
+        _messages.last().line = pictureLine(m.captured(1).toInt());
+        _awaitingErrorLine = false;
+        return;
+    }
+
+    m = warning.match(line);
+    if (m.hasMatch() || badBox.match(line).hasMatch()) {
+        LatexMessage msg;
+        msg.type = LatexMessage::Warning;
+        msg.text = m.hasMatch() ? m.captured(2) : line;
+        msg.line = -1;
+        _messages << msg;
+    }
+
+    // warnings give their line at the end, which may be on a continuation line
+    m = inputLine.match(line);
+    if (m.hasMatch() && !_messages.isEmpty() &&
+        _messages.last().type == LatexMessage::Warning && _messages.last().line == -1)
+    {
+        _messages.last().line = pictureLine(m.captured(1).toInt());
+    }
+}
+
+int LatexProcess::pictureLine(int texLine) const
+{
+    if (_bodyOffset < 0 || texLine <= _bodyOffset) return -1;
+    return texLine - _bodyOffset;
+}
+
+void LatexProcess::flushOutput()
+{
+    _flushTimer->stop();
+    if (_attached && !_pendingLines.isEmpty()) {
+        _output->appendPlainText(_pendingLines.join("\n"));
+    }
+    _pendingLines.clear();
+}
+
+void LatexProcess::reportMessages()
+{
+    int errors = 0;
+    int warnings = 0;
+    foreach (LatexMessage msg, _messages) {
+        if (msg.type == LatexMessage::Error) ++errors;
+        else ++warnings;
+    }
+    if (errors == 0 && warnings == 0) return;
+
+    appendOutput("\n" + QString::number(errors) + " ERROR(S), " +
+                 QString::number(warnings) + " WARNING(S):");
+    foreach (LatexMessage msg, _messages) {
+        QString where = (msg.line != -1) ? " (line " + QString::number(msg.line) + ")" : QString();
+        appendOutput(QString(msg.type == LatexMessage::Error ? "  ERROR" : "  WARNING") +
+                     where + ": " + msg.text);
+    }
+}
+
+void LatexProcess::showStatus(PreviewWindow::Status status)
+{
+    // a finished run shows all of its output straight away
+    if (status != PreviewWindow::Running) {
+        if (!_partialLine.isEmpty()) {
+            addLine(QString::fromLocal8Bit(_partialLine));
+            _partialLine.clear();
+        }
+        flushOutput();
+    }
+
+    _status = status;
+    _elapsed = (status == PreviewWindow::Running) ? -1 : _timer.elapsed();
+    if (_attached) _preview->setStatus(_status, _elapsed);
+}
+
+void LatexProcess::showPdf(QString pdf)
+{
+    _pdf = pdf;
+    if (_attached) _preview->setPdf(pdf);
+}
+
+void LatexProcess::readBatchLog()
+{
+    QFile f(_workingDir.path() + "/preview.log");
+    if (!f.open(QIODevice::ReadOnly)) return;
+    QTextStream log(&f);
+
+    QRegularExpression marker("^" BATCH_MARKER " (\\d+) (START|END) (\\d+)");
+    QRegularExpression errorLine("^l\\.(\\d+)");
+    QMap<int,int> starts;
+    int current = -1;
+    bool inError = false;
+    while (!log.atEnd()) {
+        QString line = log.readLine();
+        QRegularExpressionMatch m = marker.match(line);
+        if (m.hasMatch()) {
+            int i = m.captured(1).toInt();
+            int pages = m.captured(3).toInt();
+            if (m.captured(2) == "START") {
+                current = i;
+                starts.insert(i, pages);
+            } else {
+                // the figure made exactly one page, without errors
+                if (starts.contains(i) && pages == starts[i] + 1 && !_figureErrors.contains(i)) {
+                    _figurePages.insert(i, starts[i]);
+                }
+                current = -1;
+            }
+            inError = false;
+        } else if (current != -1 && line.startsWith("!")) {
+            _figureErrors[current] << line;
+            inError = true;
+        } else if (inError && line.startsWith("l.")) {
+            // the line where the error was found, which is counted from the start of
+            // preview.tex, and is reported from the start of the figure
+            QRegularExpressionMatch em = errorLine.match(line);
+            int bodyLine = em.hasMatch() ? pictureLine(em.captured(1).toInt()) : -1;
+            if (bodyLine != -1 && bodyLine > _figureStarts.value(current)) {
+                line = "l." + QString::number(bodyLine - _figureStarts.value(current)) +
+                       line.mid(em.capturedEnd(0));
+            }
+            _figureErrors[current] << line;
+            inError = false;
+        }
+    }
+}
+
+void LatexProcess::copyToDir(QString source, QString name, QString dir)
+{
+    // QFile::copy won't overwrite, and the source may have changed since last time
+    QString dest = dir + "/" + name;
+    if (QFile::exists(dest)) QFile::remove(dest);
+    QFile::copy(source, dest);
+}
+
+void LatexProcess::buildFormat()
+{
+    QString dir = formatDir().path();
+    appendOutput("BUILDING PREAMBLE FORMAT IN: " + dir + "\n");
+
+    typedef QPair<QString,QString> InputFile;
+    foreach (InputFile in, _inputFiles) copyToDir(in.first, in.second, dir);
+
+    QFile f(dir + "/" PREAMBLE_FORMAT ".tex");
+    f.open(QIODevice::WriteOnly);
+    QTextStream tex(&f);
+    tex << _preamble;
+    tex << "\\dump\n";
+    f.close();
+
+    LatexWorker *worker = tikzit->latexWorker();
+    _buildingFormat = true;
+    connect(worker, SIGNAL(formatOutput(QByteArray)), this, SLOT(formatOutput(QByteArray)));
+    connect(worker, SIGNAL(formatBuilt(bool)), this, SLOT(formatBuilt(bool)));
+    worker->buildFormat(_pdflatex, dir, _preambleKey);
+}
+
+void LatexProcess::runPreview()
+{
+    bool useFormat = (_preambleKey == tikzit->latexWorker()->formatKey()) &&
+        QFile::exists(formatDir().path() + "/" PREAMBLE_FORMAT ".fmt");
+
+    // a waiting process stops at the first error, which would spoil a batch
+    if (useFormat && _figureCount == 0) {
+        LatexWorker *worker = tikzit->latexWorker();
+        QProcess *warm = worker->take(_preambleKey, _warmJob);
+        if (warm != nullptr) {
+            runWarm(warm);
+            return;
+        }
+
+        // there is no waiting process this time, but there will be next time
+        worker->warmUp(_pdflatex, formatDir().path(), _preambleKey);
+    }
+
+    if (useFormat) {
+        // use a copy of the format, so it is found by name in the working directory
+        copyToDir(formatDir().path() + "/" PREAMBLE_FORMAT ".fmt",
+                  PREAMBLE_FORMAT ".fmt", _workingDir.path());
+        appendOutput("USING PRECOMPILED PREAMBLE\n");
+    } else {
+        typedef QPair<QString,QString> InputFile;
+        foreach (InputFile in, _inputFiles) copyToDir(in.first, in.second, _workingDir.path());
+    }
+
+    // write out the file containing the tikz picture, which starts after the
+    // preamble (if any) and two lines
+    _bodyOffset = (useFormat ? 0 : _preamble.count('\n')) + 2;
+    QFile f(_workingDir.path() + "/preview.tex");
+    f.open(QIODevice::WriteOnly);
+    QTextStream tex(&f);
+    if (!useFormat) tex << _preamble;
     tex << "\\begin{document}\n\n";
-    tex << tikz;
+    tex << _tikz;
     tex << "\n\n\\end{document}\n";
+    f.close();
+
+    QStringList args;
+    args << "-interaction=nonstopmode";
+    if (_figureCount == 0) args << "-halt-on-error";
+    if (useFormat) args << "&" PREAMBLE_FORMAT;
+    args << "preview.tex";
 
+    _proc->setWorkingDirectory(_workingDir.path());
+    _proc->start(_pdflatex, args);
+}
+
+void LatexProcess::runWarm(QProcess *warm)
+{
+    appendOutput("USING WAITING pdflatex PROCESS\n");
+
+    // the process runs in the format directory, so the picture goes there too
+    _bodyOffset = 2;
+    QFile f(formatDir().path() + "/" + _warmJob + ".tex");
+    f.open(QIODevice::WriteOnly);
+    QTextStream tex(&f);
+    tex << "\\begin{document}\n\n";
+    tex << _tikz;
+    tex << "\n\n\\end{document}\n";
     f.close();
-    _proc->start(pdflatex,
-                 QStringList()
-                 << "-interaction=nonstopmode"
-                 << "-halt-on-error"
-                 << "preview.tex");
 
+    // this may be called from a signal of the old process, so don't delete it yet
+    disconnect(_proc, nullptr, this, nullptr);
+    _proc->deleteLater();
+    _proc = warm;
+    _proc->setParent(this);
+    connect(_proc, SIGNAL(readyReadStandardOutput()), this, SLOT(readyReadStandardOutput()));
+    connect(_proc, SIGNAL(finished(int)), this, SLOT(finished(int)));
+
+    // whatever the process printed while loading the format
+    readyReadStandardOutput();
+
+    // if the process has died in the meantime, finished() takes care of it
+    _proc->write(("\\nonstopmode\\input{" + _warmJob + "}\n").toLatin1());
+    _proc->closeWriteChannel();
 }
 
-void LatexProcess::kill()
+void LatexProcess::removeWarmFiles()
 {
-    if (_proc->state() == QProcess::Running) _proc->kill();
+    LatexWorker::removeJobFiles(formatDir().path(), _warmJob);
+    _warmJob.clear();
+}
+
+QTemporaryDir &LatexProcess::formatDir()
+{
+    static QTemporaryDir dir;
+    return dir;
 }
 
 void LatexProcess::readyReadStandardOutput()
 {
-    QByteArray s = _proc->readAllStandardOutput();
-    _output->appendPlainText(s);
+    appendProcessOutput(_proc->readAllStandardOutput());
+}
+
+void LatexProcess::formatOutput(QByteArray output)
+{
+    appendProcessOutput(output);
+}
+
+void LatexProcess::formatBuilt(bool success)
+{
+    disconnect(tikzit->latexWorker(), nullptr, this, nullptr);
+    _buildingFormat = false;
+
+    // errors in the preamble are reported by the preview itself
+    _messages.clear();
+    _awaitingErrorLine = false;
+    if (success) appendOutput("\n\nPREAMBLE FORMAT BUILT\n");
+    else appendOutput("\n\nCOULD NOT BUILD PREAMBLE FORMAT, USING FULL PREAMBLE\n");
+    runPreview();
 }
 
 void LatexProcess::finished(int exitCode)
 {
-    QByteArray s = _proc->readAllStandardOutput();
-    _output->appendPlainText(s);
+    appendProcessOutput(_proc->readAllStandardOutput());
+
+    if (!_warmJob.isEmpty()) {
+        // collect the output of a waiting process from the format directory
+        QDir dir(formatDir().path());
+        if (exitCode == 0) copyToDir(dir.filePath(_warmJob + ".pdf"), "preview.pdf", _workingDir.path());
+        removeWarmFiles();
+    }
+
+    if (_figureCount > 0) {
+        // errors in some figures don't stop the others from being typeset
+        readBatchLog();
+        QString pdf = _workingDir.path() + "/preview.pdf";
+        int ok = 0;
+        for (int i = 0; i < _figureCount; ++i) if (figurePage(i) != -1) ++ok;
+        appendOutput("\n\nTYPESET " + QString::number(ok) + " OF " +
+                     QString::number(_figureCount) + " FIGURES\n");
+        if (ok > 0 && QFile::exists(pdf)) showPdf(pdf);
+        showStatus((ok == _figureCount) ? PreviewWindow::Success : PreviewWindow::Failed);
+        emit previewFinished();
+        return;
+    }
 
     if (exitCode == 0) {
         QString pdf = _workingDir.path() + "/preview.pdf";
-        _output->appendPlainText("\n\nSUCCESSFULLY GENERATED: " + pdf + "\n");
-        _preview->setPdf(pdf);
-        _preview->setStatus(PreviewWindow::Success);
+        appendOutput("\n\nSUCCESSFULLY GENERATED: " + pdf + "\n");
+        reportMessages();
+        PreviewCache::insert(_cacheKey, pdf);
+        showPdf(pdf);
+        showStatus(PreviewWindow::Success);
         emit previewFinished();
     } else {
-        _output->appendPlainText("\n\npdflatex RETURNED AN ERROR\n");
-        _preview->setStatus(PreviewWindow::Failed);
+        appendOutput("\n\npdflatex RETURNED AN ERROR\n");
+        reportMessages();
+        showStatus(PreviewWindow::Failed);
         emit previewFinished();
     }
 }
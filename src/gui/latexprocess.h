@@ -19,17 +19,51 @@
 /*!
  * Run pdflatex and dump its output to the appropriate tab of
  * the PreviewWindow.
+ *
+ * The preamble of the preview document is precompiled once into a format
+ * file, which is shared by all previews and rebuilt whenever the preamble or
+ * any of the files it loads change. Previews then only compile the picture.
+ *
+ * A batch of figures can also be typeset in a single run, one page per
+ * figure. The log then tells which page each figure is on, and which errors
+ * each figure caused.
  */
 
 #ifndef LATEXPROCESS_H
 #define LATEXPROCESS_H
 
 #include "previewwindow.h"
+#include "latexworker.h"
 
 #include <QObject>
 #include <QProcess>
 #include <QTemporaryDir>
+#include <QElapsedTimer>
 #include <QPlainTextEdit>
+#include <QList>
+#include <QPair>
+#include <QStringList>
+#include <QContiguousCache>
+#include <QMap>
+#include <QTimer>
+
+// marks the start and end of each figure of a batch in the log
+#define BATCH_MARKER "TIKZIT-FIGURE"
+
+// how many lines of output are kept, and how often (in ms) new output is shown
+#define LATEX_LOG_MAX_LINES 5000
+#define LATEX_LOG_FLUSH_INTERVAL 100
+
+/*!
+ * An error or warning found in the output of pdflatex.
+ */
+struct LatexMessage {
+    enum Type { Error, Warning };
+    Type type;
+    QString text;
+    // the line of the tikzpicture it refers to, or -1 if it isn't known
+    int line;
+};
 
 class LatexProcess : public QObject
 {
@@ -37,17 +71,125 @@ class LatexProcess : public QObject
 public:
     explicit LatexProcess(PreviewWindow *preview, QObject *parent = nullptr);
     void makePreview(QString tikz);
+
+    /*!
+     * \brief makeBatch typesets several tikzpictures in one run. Unlike a single
+     * preview, an error doesn't stop the run, so the figures that are fine still
+     * get typeset.
+     */
+    void makeBatch(QStringList figures);
     void kill();
 
+    /*!
+     * \brief pdf returns the PDF that was made, or an empty string if there is none.
+     */
+    QString pdf() const;
+
+    /*!
+     * \brief figurePage returns the (zero-based) page of the PDF holding the given
+     * figure of a batch, or -1 if the figure failed.
+     */
+    int figurePage(int i) const;
+
+    /*!
+     * \brief figureErrors returns the errors in the log caused by the given figure
+     * of a batch. Line numbers ("l.N") count from the start of the figure.
+     */
+    QStringList figureErrors(int i) const;
+
+    /*!
+     * \brief messages returns the errors and warnings found in the output so far.
+     */
+    QList<LatexMessage> messages() const;
+
+    /*!
+     * \brief setAttached chooses whether this process shows its output, status and
+     * PDF in the preview window. Attaching brings the window up to date with
+     * everything the process has done so far.
+     */
+    void setAttached(bool attached);
+    bool isRunning() const;
+
 private:
+    void start(QString tikz);
+    void readBatchLog();
+    void appendOutput(QString text);
+    void appendProcessOutput(QByteArray output);
+    void addLine(QString line);
+    void parseLine(QString line);
+    int pictureLine(int texLine) const;
+    void reportMessages();
+    void showStatus(PreviewWindow::Status status);
+    void showPdf(QString pdf);
+    void copyToDir(QString source, QString name, QString dir);
+    void buildFormat();
+    void runPreview();
+    void runWarm(QProcess *warm);
+    void removeWarmFiles();
+
+    /*!
+     * \brief formatDir returns the directory that holds the precompiled preamble.
+     * It lives as long as the application, unlike the working directories of
+     * individual previews.
+     */
+    static QTemporaryDir &formatDir();
+
     QTemporaryDir _workingDir;
     PreviewWindow *_preview;
     QPlainTextEdit *_output;
     QProcess *_proc;
 
+    bool _attached;
+
+    // the last LATEX_LOG_MAX_LINES lines of output, and the number dropped before them
+    QContiguousCache<QString> _log;
+    int _droppedLines;
+    // the undecoded start of a line whose end hasn't arrived yet
+    QByteArray _partialLine;
+
+    // lines not shown yet, which are shown when _flushTimer runs out
+    QStringList _pendingLines;
+    QTimer *_flushTimer;
+
+    QList<LatexMessage> _messages;
+    bool _awaitingErrorLine;
+
+    // the number of lines in the TeX file before the tikzpicture, or -1
+    int _bodyOffset;
+
+    PreviewWindow::Status _status;
+    qint64 _elapsed;
+    QString _pdf;
+
+    QString _pdflatex;
+    QString _tikz;
+    QElapsedTimer _timer;
+    QString _preamble;
+    QByteArray _preambleKey;
+    QByteArray _cacheKey;
+
+    // files loaded by the preamble, as (source path, file name) pairs
+    QList<QPair<QString,QString>> _inputFiles;
+
+    // the number of figures in a batch, or 0 for a single preview
+    int _figureCount;
+    // the number of lines of the batch body before each figure
+    QList<int> _figureStarts;
+    QMap<int,int> _figurePages;
+    QMap<int,QStringList> _figureErrors;
+
+    // the job name of the waiting process running this preview, if any
+    QString _warmJob;
+
+    // whether this preview is waiting for the worker to build the format file
+    bool _buildingFormat;
+
 public slots:
     void readyReadStandardOutput();
     void finished(int exitCode);
+    void flushOutput();
+    void formatOutput(QByteArray output);
+    void formatBuilt(bool success);
 
 signals:
     void previewFinished();
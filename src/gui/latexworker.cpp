@@ -0,0 +1,219 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "latexworker.h"
+
+#include <QStringList>
+#include <QDir>
+
+LatexWorker::LatexWorker(QObject *parent) : QObject(parent)
+{
+    _proc = nullptr;
+    _formatProc = nullptr;
+    _jobCount = 0;
+    _restarts = 0;
+}
+
+void LatexWorker::warmUp(QString pdflatex, QString dir, QByteArray key)
+{
+    if (_proc != nullptr && pdflatex == _pdflatex && dir == _dir && key == _key) return;
+
+    shutDown();
+    _pdflatex = pdflatex;
+    _dir = dir;
+    _key = key;
+    _restarts = 0;
+    start();
+}
+
+QProcess *LatexWorker::take(QByteArray key, QString &jobName)
+{
+    if (_proc == nullptr || key != _key || _proc->state() == QProcess::NotRunning)
+        return nullptr;
+
+    QProcess *proc = _proc;
+    disconnect(proc, nullptr, this, nullptr);
+    proc->setParent(nullptr);
+    _proc = nullptr;
+    jobName = _jobName;
+
+    // get the next one ready while this one does its job
+    _restarts = 0;
+    start();
+
+    return proc;
+}
+
+void LatexWorker::shutDown()
+{
+    if (_proc == nullptr) return;
+    disconnect(_proc, nullptr, this, nullptr);
+    _proc->kill();
+    _proc->deleteLater();
+    _proc = nullptr;
+}
+
+void LatexWorker::discard(QProcess *proc, QString jobName)
+{
+    proc->setParent(this);
+    _discardedJobs.insert(proc, jobName);
+    if (proc->state() == QProcess::NotRunning) {
+        removeDiscarded(proc);
+    } else {
+        connect(proc, SIGNAL(finished(int)), this, SLOT(discardedFinished()));
+        proc->kill();
+    }
+}
+
+void LatexWorker::removeJobFiles(QString dir, QString jobName)
+{
+    QDir d(dir);
+    foreach (QString file, d.entryList(QStringList() << (jobName + ".*"), QDir::Files)) {
+        d.remove(file);
+    }
+}
+
+void LatexWorker::discardedFinished()
+{
+    QProcess *proc = qobject_cast<QProcess*>(sender());
+    if (proc != nullptr) removeDiscarded(proc);
+}
+
+void LatexWorker::removeDiscarded(QProcess *proc)
+{
+    removeJobFiles(proc->workingDirectory(), _discardedJobs.take(proc));
+    proc->deleteLater();
+}
+
+void LatexWorker::buildFormat(QString pdflatex, QString dir, QByteArray key)
+{
+    if (_formatProc != nullptr) return;
+
+    // the waiting process has the old format loaded, and the old format is
+    // overwritten, so it can't be used even if this build fails
+    shutDown();
+    _formatKey.clear();
+    _formatPdflatex = pdflatex;
+    _formatDir = dir;
+    _buildKey = key;
+
+    _formatProc = new QProcess(this);
+    _formatProc->setProcessChannelMode(QProcess::MergedChannels);
+    _formatProc->setWorkingDirectory(dir);
+    connect(_formatProc, SIGNAL(readyReadStandardOutput()), this, SLOT(readFormatOutput()));
+    connect(_formatProc, SIGNAL(finished(int)), this, SLOT(formatFinished(int)));
+    connect(_formatProc, SIGNAL(errorOccurred(QProcess::ProcessError)),
+            this, SLOT(formatError(QProcess::ProcessError)));
+    _formatProc->start(pdflatex,
+                       QStringList()
+                       << "-ini"
+                       << "-interaction=nonstopmode"
+                       << "-halt-on-error"
+                       << "-jobname=" PREAMBLE_FORMAT
+                       << "&pdflatex"
+                       << PREAMBLE_FORMAT ".tex");
+}
+
+bool LatexWorker::isBuildingFormat() const
+{
+    return _formatProc != nullptr;
+}
+
+QByteArray LatexWorker::formatKey() const
+{
+    return _formatKey;
+}
+
+QByteArray LatexWorker::failedFormatKey() const
+{
+    return _failedFormatKey;
+}
+
+void LatexWorker::readFormatOutput()
+{
+    emit formatOutput(_formatProc->readAllStandardOutput());
+}
+
+void LatexWorker::formatFinished(int exitCode)
+{
+    emit formatOutput(_formatProc->readAllStandardOutput());
+    _formatProc->deleteLater();
+    _formatProc = nullptr;
+
+    if (exitCode == 0) {
+        _formatKey = _buildKey;
+        warmUp(_formatPdflatex, _formatDir, _buildKey);
+    } else {
+        _failedFormatKey = _buildKey;
+    }
+    emit formatBuilt(exitCode == 0);
+}
+
+void LatexWorker::formatError(QProcess::ProcessError error)
+{
+    // other errors are followed by finished()
+    if (error != QProcess::FailedToStart) return;
+    _formatProc->deleteLater();
+    _formatProc = nullptr;
+    _failedFormatKey = _buildKey;
+    emit formatBuilt(false);
+}
+
+void LatexWorker::processFinished(int)
+{
+    // a waiting process should never finish on its own
+    _proc->deleteLater();
+    _proc = nullptr;
+
+    if (_restarts < LATEX_WORKER_MAX_RESTARTS) {
+        _restarts++;
+        start();
+    }
+}
+
+void LatexWorker::processError(QProcess::ProcessError error)
+{
+    // a process that never started doesn't finish either. It isn't restarted, as it
+    // would most likely fail the same way, but the next warmUp() tries again.
+    if (error != QProcess::FailedToStart) return;
+    _proc->deleteLater();
+    _proc = nullptr;
+}
+
+void LatexWorker::start()
+{
+    // each process gets its own job name, so its output files don't collide with
+    // those of the process before it, which may still be running
+    _jobName = "warm-" + QString::number(_jobCount);
+    _jobCount++;
+
+    _proc = new QProcess(this);
+    _proc->setProcessChannelMode(QProcess::MergedChannels);
+    _proc->setWorkingDirectory(_dir);
+    connect(_proc, SIGNAL(finished(int)), this, SLOT(processFinished(int)));
+    connect(_proc, SIGNAL(errorOccurred(QProcess::ProcessError)),
+            this, SLOT(processError(QProcess::ProcessError)));
+
+    // with no input file, pdflatex loads the format and then waits for its first
+    // line of input on stdin
+    _proc->start(_pdflatex,
+                 QStringList()
+                 << "-halt-on-error"
+                 << "-jobname=" + _jobName
+                 << "&" PREAMBLE_FORMAT);
+}
@@ -0,0 +1,137 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*!
+ * Keeps a pdflatex process waiting with the precompiled preview preamble
+ * already loaded, so a preview only has to pay for typesetting the picture.
+ * The waiting process is handed over to a LatexProcess, which sends it the
+ * job over its standard input, and a new one is started straight away to wait
+ * for the next preview. If a waiting process dies, it is restarted.
+ *
+ * The worker also builds the format file itself. A build belongs to the
+ * worker rather than to the preview that asked for it, so cancelling that
+ * preview doesn't leave the format half-built.
+ */
+
+#ifndef LATEXWORKER_H
+#define LATEXWORKER_H
+
+#include <QObject>
+#include <QProcess>
+#include <QHash>
+
+// name of the format file (and its source) holding the precompiled preamble
+#define PREAMBLE_FORMAT "preview-preamble"
+
+// how many times in a row a waiting process may die before giving up
+#define LATEX_WORKER_MAX_RESTARTS 3
+
+class LatexWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LatexWorker(QObject *parent = nullptr);
+
+    /*!
+     * \brief warmUp makes sure a process is waiting on the format in the given
+     * directory, built from the preamble with the given key.
+     */
+    void warmUp(QString pdflatex, QString dir, QByteArray key);
+
+    /*!
+     * \brief take hands over the waiting process, if it was started for the
+     * preamble with the given key. The caller takes ownership of the process.
+     * \param jobName set to the job name the process was started with
+     * \return the process, or nullptr if no suitable process is waiting
+     */
+    QProcess *take(QByteArray key, QString &jobName);
+
+    /*!
+     * \brief shutDown stops the waiting process, e.g. because its format is
+     * about to be rebuilt.
+     */
+    void shutDown();
+
+    /*!
+     * \brief buildFormat compiles PREAMBLE_FORMAT.tex in the given directory into a
+     * format file, for the preamble with the given key. The output of the build is
+     * passed on through formatOutput(), and formatBuilt() is emitted when it is done.
+     */
+    void buildFormat(QString pdflatex, QString dir, QByteArray key);
+    bool isBuildingFormat() const;
+
+    /*!
+     * \brief formatKey returns the key of the preamble the format file was built
+     * from, or an empty key if there is no usable format file.
+     */
+    QByteArray formatKey() const;
+
+    /*!
+     * \brief failedFormatKey returns the key of the last preamble that could not be
+     * made into a format.
+     */
+    QByteArray failedFormatKey() const;
+
+    /*!
+     * \brief discard takes back a process handed out by take() whose preview was
+     * cancelled. The process is killed, and the files of its job are removed once it
+     * has finished, without waiting for it here.
+     */
+    void discard(QProcess *proc, QString jobName);
+
+    /*!
+     * \brief removeJobFiles removes the files a process with the given job name has
+     * written in the given directory.
+     */
+    static void removeJobFiles(QString dir, QString jobName);
+
+signals:
+    void formatOutput(QByteArray output);
+    void formatBuilt(bool success);
+
+private slots:
+    void processFinished(int exitCode);
+    void processError(QProcess::ProcessError error);
+    void readFormatOutput();
+    void formatFinished(int exitCode);
+    void formatError(QProcess::ProcessError error);
+    void discardedFinished();
+
+private:
+    void start();
+    void removeDiscarded(QProcess *proc);
+
+    QProcess *_proc;
+    QProcess *_formatProc;
+    QString _formatPdflatex;
+    QString _formatDir;
+    QByteArray _buildKey;
+    QByteArray _formatKey;
+    QByteArray _failedFormatKey;
+    QString _pdflatex;
+    QString _dir;
+    QString _jobName;
+    QByteArray _key;
+    int _jobCount;
+    int _restarts;
+
+    // cancelled processes that are still shutting down, with their job names
+    QHash<QProcess*,QString> _discardedJobs;
+};
+
+#endif // LATEXWORKER_H
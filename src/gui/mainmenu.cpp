@@ -35,6 +35,8 @@ MainMenu::MainMenu()
         ui.actionCheck_for_updates_automatically->blockSignals(false);
     }
 
+    ui.actionAuto_Preview->setChecked(tikzit->preferences()->autoPreview());
+
     updateRecentFiles();
 }
 
@@ -282,6 +284,7 @@ void MainMenu::on_actionRevert_triggered()
     if (win != 0) {
         win->tikzDocument()->refreshTikz();
         win->tikzScene()->setEnabled(true);
+        win->highlightSelection();
     }
 }
 
@@ -304,6 +307,16 @@ void MainMenu::on_actionRun_LaTeX_triggered()
     tikzit->makePreview();
 }
 
+void MainMenu::on_actionAuto_Preview_triggered()
+{
+    tikzit->preferences()->setAutoPreview(ui.actionAuto_Preview->isChecked());
+}
+
+void MainMenu::on_actionExport_Images_of_Folder_triggered()
+{
+    tikzit->exportFolderImages();
+}
+
 void MainMenu::on_actionPrevious_Node_Style_triggered()
 {
     tikzit->activeWindow()->stylePalette()->previousNodeStyle();
@@ -361,6 +374,13 @@ void MainMenu::on_actionShow_Node_Labels_triggered()
     }
 }
 
+void MainMenu::on_actionShow_Repaints_triggered()
+{
+    if (tikzit->activeWindow() != 0) {
+        tikzit->activeWindow()->tikzView()->setShowRepaints(ui.actionShow_Repaints->isChecked());
+    }
+}
+
 void MainMenu::on_actionAbout_triggered()
 {
     QMessageBox::about(this,
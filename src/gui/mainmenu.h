@@ -76,6 +76,8 @@ public slots:
     void on_actionRevert_triggered();
     void on_actionJump_to_Selection_triggered();
     void on_actionRun_LaTeX_triggered();
+    void on_actionAuto_Preview_triggered();
+    void on_actionExport_Images_of_Folder_triggered();
     void on_actionPrevious_Node_Style_triggered();
     void on_actionNext_Node_Style_triggered();
     void on_actionClear_Node_Style_triggered();
@@ -88,6 +90,7 @@ public slots:
     void on_actionZoom_In_triggered();
     void on_actionZoom_Out_triggered();
     void on_actionShow_Node_Labels_triggered();
+    void on_actionShow_Repaints_triggered();
 
     // Help
     void on_actionAbout_triggered();
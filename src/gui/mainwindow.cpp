@@ -5,6 +5,7 @@
 #include "tikzassembler.h"
 #include "toolpalette.h"
 #include "tikzit.h"
+#include "tikzhighlighter.h"
 
 #include <QDebug>
 #include <QFile>
@@ -12,10 +13,13 @@
 #include <QSettings>
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QPlainTextEdit>
 #include <QTextEdit>
 #include <QTextBlock>
+#include <QTextDocument>
 #include <QIcon>
 #include <QPushButton>
+#include <algorithm>
 
 int MainWindow::_numWindows = 0;
 
@@ -53,13 +57,20 @@ MainWindow::MainWindow(QWidget *parent) :
     sz[0] = sz[0] + sz[1];
     sz[1] = 0;
     ui->splitter->setSizes(sz);
+    _sourceStale = false;
+    new TikzHighlighter(ui->tikzSource->document());
+    connect(ui->splitter, SIGNAL(splitterMoved(int,int)), this, SLOT(syncSourceIfStale()));
+    connect(ui->tikzSource, SIGNAL(cursorPositionChanged()), this, SLOT(sourceCursorMoved()));
+    connect(_tikzScene, SIGNAL(selectedElementsChanged()), this, SLOT(highlightSelection()));
 
     _tikzDocument->refreshTikz();
 
     connect(_tikzDocument->undoStack(), SIGNAL(cleanChanged(bool)), this, SLOT(updateFileName()));
+    connect(_tikzDocument->undoStack(), SIGNAL(indexChanged(int)), this, SLOT(requestAutoPreview()));
     _menu->addDocks(createPopupMenu());
 
     setFont();
+    connect(tikzit->preferences(), &Preferences::sourceFontChanged, this, &MainWindow::setFont);
 
     QVariant state = settings.value(QString("windowState-main-qt") + qVersion());
     if (state.isValid()) {
@@ -78,18 +89,13 @@ MainWindow::~MainWindow()
 
 void MainWindow::setFont()
 {
-    QSettings settings("tikzit", "tikzit");
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
     ui->tikzSource->setTabStopDistance(20.0);
 #else
     ui->tikzSource->setTabStopWidth(20);
 #endif
 
-    QFont font("Courier New", 12);
-    if (settings.contains("source-font")) {
-        font.fromString(settings.value("source-font").toString());
-    }
-    ui->tikzSource->setFont(font);
+    ui->tikzSource->setFont(tikzit->preferences()->sourceFont());
 }
 
 void MainWindow::restorePosition()
@@ -176,15 +182,21 @@ StylePalette *MainWindow::stylePalette() const
 
 QString MainWindow::tikzSource()
 {
+    syncSourceIfStale();
     return ui->tikzSource->toPlainText();
 }
 
 void MainWindow::setSourceLine(int line)
 {
+    syncSourceIfStale();
     QTextCursor cursor(ui->tikzSource->document()->findBlockByLineNumber(line));
     cursor.movePosition(QTextCursor::EndOfLine);
     //ui->tikzSource->moveCursor(QTextCursor::End);
+
+    // don't let moving the cursor change the selection
+    ui->tikzSource->blockSignals(true);
     ui->tikzSource->setTextCursor(cursor);
+    ui->tikzSource->blockSignals(false);
     ui->tikzSource->setFocus();
 }
 
@@ -198,10 +210,124 @@ void MainWindow::updateFileName()
 
 void MainWindow::refreshTikz()
 {
-    // don't emit textChanged() when we update the tikz
+    // while the source view is collapsed, put off updating it until it is shown again
+    if (ui->splitter->sizes().value(1) == 0) {
+        _sourceStale = true;
+    } else {
+        syncSource();
+    }
+}
+
+void MainWindow::syncSourceIfStale()
+{
+    if (_sourceStale) syncSource();
+}
+
+void MainWindow::syncSource()
+{
+    _sourceStale = false;
+    QStringList lines = _tikzDocument->tikz().split('\n');
+    QTextDocument *doc = ui->tikzSource->document();
+
+    // skip over the lines at the start and end that haven't changed, always leaving
+    // at least one line in the middle to patch
+    int oldCount = doc->blockCount();
+    int newCount = lines.size();
+    int max = qMin(oldCount, newCount) - 1;
+    int prefix = 0;
+    QTextBlock b = doc->firstBlock();
+    while (prefix < max && b.text() == lines[prefix]) {
+        ++prefix;
+        b = b.next();
+    }
+    int suffix = 0;
+    b = doc->lastBlock();
+    while (prefix + suffix < max && b.text() == lines[newCount - 1 - suffix]) {
+        ++suffix;
+        b = b.previous();
+    }
+
+    // don't emit textChanged() when we update the tikz, and don't put the update on
+    // the undo stack of the text view
     ui->tikzSource->blockSignals(true);
-    ui->tikzSource->setText(_tikzDocument->tikz());
+    doc->setUndoRedoEnabled(false);
+    QTextCursor cursor(doc);
+    cursor.beginEditBlock();
+
+    if (oldCount == newCount) {
+        // lines were changed in place, e.g. when nodes are moved or restyled, so
+        // only patch the lines that differ
+        for (int i = prefix; i < oldCount - suffix; ++i) {
+            b = doc->findBlockByNumber(i);
+            if (b.text() != lines[i]) {
+                cursor.setPosition(b.position());
+                cursor.movePosition(QTextCursor::EndOfBlock, QTextCursor::KeepAnchor);
+                cursor.insertText(lines[i]);
+            }
+        }
+    } else {
+        QTextBlock last = doc->findBlockByNumber(oldCount - suffix - 1);
+        cursor.setPosition(doc->findBlockByNumber(prefix).position());
+        cursor.setPosition(last.position() + last.length() - 1, QTextCursor::KeepAnchor);
+        cursor.insertText(lines.mid(prefix, newCount - suffix - prefix).join('\n'));
+    }
+
+    cursor.endEditBlock();
+    doc->setUndoRedoEnabled(true);
     ui->tikzSource->blockSignals(false);
+
+    highlightSelection();
+}
+
+void MainWindow::sourceCursorMoved()
+{
+    // only follow clicks and key presses in an unmodified source view
+    if (_sourceStale || !ui->tikzSource->hasFocus() || !_tikzScene->enabled()) return;
+    QTextCursor cursor = ui->tikzSource->textCursor();
+    if (cursor.hasSelection()) return;
+    _tikzScene->selectAtSourcePosition(cursor.position());
+}
+
+void MainWindow::highlightSelection()
+{
+    if (_sourceStale) return;
+
+    QList<QTextEdit::ExtraSelection> sels;
+    if (_tikzScene->enabled()) {
+        QTextDocument *doc = ui->tikzSource->document();
+        typedef QPair<int,int> Range;
+        QVector<Range> ranges = _tikzScene->sourceRangesForSelection();
+        std::sort(ranges.begin(), ranges.end());
+
+        // merge ranges that overlap, or are only separated by whitespace (e.g. the
+        // code of consecutive nodes), so whole blocks of selected code need just one
+        // extra selection
+        QVector<Range> merged;
+        foreach (Range r, ranges) {
+            if (!merged.isEmpty()) {
+                Range &last = merged.last();
+                int p = last.second;
+                while (p < r.first && doc->characterAt(p).isSpace()) ++p;
+                if (p >= r.first) {
+                    last.second = qMax(last.second, r.second);
+                    continue;
+                }
+            }
+            merged << r;
+        }
+
+        if (merged.size() <= SOURCE_HIGHLIGHT_MAX_RANGES) {
+            QTextEdit::ExtraSelection sel;
+            sel.format.setBackground(QColor(200,200,255));
+            foreach (Range r, merged) {
+                sel.cursor = QTextCursor(doc);
+                sel.cursor.setPosition(r.first);
+                sel.cursor.setPosition(r.second, QTextCursor::KeepAnchor);
+                sels << sel;
+            }
+        }
+    }
+    ui->tikzSource->setExtraSelections(sels);
 }
 
 ToolPalette *MainWindow::toolPalette() const
@@ -229,9 +355,18 @@ TikzView *MainWindow::tikzView() const
     return ui->tikzView;
 }
 
+void MainWindow::requestAutoPreview()
+{
+    if (tikzit->activeWindow() == this) tikzit->requestAutoPreview();
+}
+
 void MainWindow::on_tikzSource_textChanged()
 {
-    if (_tikzScene->enabled()) _tikzScene->setEnabled(false);
+    if (_tikzScene->enabled()) {
+        _tikzScene->setEnabled(false);
+        // the highlighted ranges no longer match the text
+        ui->tikzSource->setExtraSelections(QList<QTextEdit::ExtraSelection>());
+    }
 }
 
 
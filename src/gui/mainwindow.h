@@ -17,6 +17,9 @@
 #include <QGraphicsView>
 #include <QSplitter>
 
+// above this many separate ranges, the selection is not highlighted in the source
+#define SOURCE_HIGHLIGHT_MAX_RANGES 500
+
 namespace Ui {
 class MainWindow;
 }
@@ -48,11 +51,28 @@ public slots:
     void on_tikzSource_textChanged();
     void updateFileName();
     void refreshTikz();
+    void syncSourceIfStale();
+    void requestAutoPreview();
+    void sourceCursorMoved();
+
+    /*!
+     * \brief highlightSelection marks the code of the selected nodes and edges in
+     * the source view. Ranges that overlap or are separated only by whitespace are
+     * merged, and nothing is marked if more than SOURCE_HIGHLIGHT_MAX_RANGES remain.
+     */
+    void highlightSelection();
 protected:
     void closeEvent(QCloseEvent *event) override;
     void changeEvent(QEvent *event) override;
 
 private:
+    /*!
+     * \brief syncSource brings the source view up to date with the document, replacing
+     * only the lines that have changed. This keeps the cursor and scroll position, and
+     * avoids laying out the whole text again.
+     */
+    void syncSource();
+
     TikzScene *_tikzScene;
     TikzDocument *_tikzDocument;
     MainMenu *_menu;
@@ -60,6 +80,7 @@ private:
     StylePalette *_stylePalette;
     Ui::MainWindow *ui;
     int _windowId;
+    bool _sourceStale;
     static int _numWindows;
 };
 
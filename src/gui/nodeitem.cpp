@@ -42,7 +42,9 @@ NodeItem::NodeItem(Node *node)
 
 void NodeItem::readPos()
 {
+    TikzScene::markItemDirty(this);
     setPos(toScreen(_node->point()));
+    TikzScene::markItemDirty(this);
 }
 
 void NodeItem::writePos()
@@ -69,6 +71,9 @@ QRectF NodeItem::outerLabelRect() const {
 
 void NodeItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *)
 {
+    bool fast = scene() && static_cast<TikzScene*>(scene())->fastRendering();
+    painter->setRenderHint(QPainter::Antialiasing, !fast);
+
     if (_node->style()->isNone()) {
         QColor c(180,180,200);
         painter->setPen(QPen(c));
@@ -94,7 +99,7 @@ void NodeItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidge
     bool drawLabel = _node->label() != "";
     if (scene()) {
         TikzScene *sc = static_cast<TikzScene*>(scene());
-        drawLabel= drawLabel && sc->drawNodeLabels();
+        drawLabel= drawLabel && sc->drawNodeLabels() && !fast;
     }
 
     if (drawLabel) {
@@ -183,6 +188,7 @@ QRectF NodeItem::boundingRect() const
 
 void NodeItem::updateBounds()
 {
+    TikzScene::markItemDirty(this);
 	prepareGeometryChange();
 	QString label = _node->label();
     QString outerLabel = _node->data()->property("label");
@@ -190,6 +196,7 @@ void NodeItem::updateBounds()
 	if (label != "") rect = rect.united(labelRect());
     if (outerLabel != "") rect = rect.united(outerLabelRect());
     _boundingRect = rect.adjusted(-4, -4, 4, 4);
+    TikzScene::markItemDirty(this);
 }
 
 Node *NodeItem::node() const
@@ -197,6 +204,39 @@ Node *NodeItem::node() const
     return _node;
 }
 
+void NodeItem::setNode(Node *node)
+{
+    // keep the scene's selection in terms of the new node
+    if (isSelected() && scene()) {
+        TikzScene *sc = static_cast<TikzScene*>(scene());
+        sc->nodeSelectionChanged(_node, false);
+        sc->nodeSelectionChanged(node, true);
+    }
+
+    _node = node;
+    readPos();
+    updateBounds();
+    update();
+}
+
+QVariant NodeItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    // report selection changes to the scene, which tracks the selected nodes
+    if (change == ItemSelectedHasChanged && scene()) {
+        static_cast<TikzScene*>(scene())->nodeSelectionChanged(_node, value.toBool());
+    } else if (change == ItemSceneChange && scene()) {
+        TikzScene::markItemDirty(this);
+        if (isSelected()) static_cast<TikzScene*>(scene())->nodeSelectionChanged(_node, false);
+    } else if (change == ItemSceneHasChanged && scene()) {
+        TikzScene::markItemDirty(this);
+        if (isSelected()) static_cast<TikzScene*>(scene())->nodeSelectionChanged(_node, true);
+    } else if (change == ItemZValueHasChanged) {
+        TikzScene::markItemDirty(this);
+    }
+
+    return QGraphicsItem::itemChange(change, value);
+}
+
 //QVariant NodeItem::itemChange(GraphicsItemChange change, const QVariant &value)
 //{
 //    if (change == ItemPositionChange) {
@@ -40,8 +40,15 @@ public:
     QPainterPath shape() const override;
     QRectF boundingRect() const override;
 	void updateBounds();
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
     Node *node() const;
 
+    /*!
+     * \brief setNode rebinds this item to a different node, e.g. the matching node
+     * of a freshly-parsed graph, and refreshes its position and bounds.
+     */
+    void setNode(Node *node);
+
 private:
     Node *_node;
     QRectF labelRect() const;
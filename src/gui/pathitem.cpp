@@ -31,6 +31,9 @@ void PathItem::readPos()
 
 void PathItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *)
 {
+    bool fast = scene() && static_cast<TikzScene*>(scene())->fastRendering();
+    painter->setRenderHint(QPainter::Antialiasing, !fast);
+
     Style *st = _path->edges().first()->style();
     QPen pen = st->pen();
     QBrush brush = st->brush();
@@ -46,6 +49,12 @@ Path *PathItem::path() const
     return _path;
 }
 
+void PathItem::setPath(Path *path)
+{
+    _path = path;
+    readPos();
+}
+
 QPainterPath PathItem::painterPath() const
 {
     return _painterPath;
@@ -53,15 +62,28 @@ QPainterPath PathItem::painterPath() const
 
 void PathItem::setPainterPath(const QPainterPath &painterPath)
 {
+    TikzScene::markItemDirty(this);
     prepareGeometryChange();
 
     _painterPath = painterPath;
     float r = GLOBAL_SCALEF * 0.1;
     _boundingRect = _painterPath.boundingRect().adjusted(-r,-r,r,r);
+    TikzScene::markItemDirty(this);
 
     update();
 }
 
+QVariant PathItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    if (change == ItemSceneChange || change == ItemSceneHasChanged ||
+        change == ItemZValueHasChanged)
+    {
+        TikzScene::markItemDirty(this);
+    }
+
+    return QGraphicsItem::itemChange(change, value);
+}
+
 QRectF PathItem::boundingRect() const
 {
     return _boundingRect;
@@ -13,11 +13,13 @@ public:
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) override;
 
     Path *path() const;
+    void setPath(Path *path);
 
     QPainterPath painterPath() const;
     void setPainterPath(const QPainterPath &painterPath);
 
     QRectF boundingRect() const override;
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
 
 private:
     Path *_path;
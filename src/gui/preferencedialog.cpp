@@ -5,44 +5,31 @@
 #include <QColorDialog>
 #include <QFontDialog>
 #include <QFileDialog>
-#include <QSettings>
 
 PreferenceDialog::PreferenceDialog(QWidget *parent) :
     QDialog(parent),
     ui(new Ui::PreferenceDialog)
 {
     ui->setupUi(this);
-    QSettings settings("tikzit", "tikzit");
-    ui->autoPdflatex->setChecked(true);
+    Preferences *prefs = tikzit->preferences();
+    ui->autoPdflatex->setChecked(prefs->autoDetectPdflatex());
+    ui->pdflatexPath->setText(prefs->pdflatexPath());
 
-    if (!settings.value("auto-detect-pdflatex").isNull())
-        ui->autoPdflatex->setChecked(settings.value("auto-detect-pdflatex").toBool());
-    if (!settings.value("pdflatex-path").isNull())
-        ui->pdflatexPath->setText(settings.value("pdflatex-path").toString());
-
-
-    setColor(ui->axesColor, settings.value("grid-color-axes",
-      QColor(220,220,240)).value<QColor>());
-    setColor(ui->majorColor, settings.value("grid-color-major",
-      QColor(240,240,250)).value<QColor>());
-    setColor(ui->minorColor, settings.value("grid-color-minor",
-      QColor(250,250,255)).value<QColor>());
+    setColor(ui->axesColor, prefs->gridColorAxes());
+    setColor(ui->majorColor, prefs->gridColorMajor());
+    setColor(ui->minorColor, prefs->gridColorMinor());
 
     connect(ui->axesColor, SIGNAL(clicked()), this, SLOT(colorClick()));
     connect(ui->majorColor, SIGNAL(clicked()), this, SLOT(colorClick()));
     connect(ui->minorColor, SIGNAL(clicked()), this, SLOT(colorClick()));
 
-    if (!settings.value("style-icon-spacing").isNull())
-        ui->styleIconSpacing->setText(settings.value("style-icon-spacing").toString());
-    else
-        ui->styleIconSpacing->setText("48");
+    ui->styleIconSpacing->setText(QString::number(prefs->styleIconSpacing()));
 
-    QString fontString = settings.value("source-font", QFont("Courier New", 12).toString()).toString();
-    ui->sourceFont->setText(fontString);
+    ui->sourceFont->setText(prefs->sourceFont().toString());
     connect(ui->sourceFontPick, SIGNAL(clicked()), this, SLOT(sourceFontPickClick()));
 
-    ui->selectNewEdges->setChecked(settings.value("select-new-edges", false).toBool());
-    ui->shiftToScroll->setChecked(settings.value("shift-to-scroll", false).toBool());
+    ui->selectNewEdges->setChecked(prefs->selectNewEdges());
+    ui->shiftToScroll->setChecked(prefs->shiftToScroll());
 }
 
 PreferenceDialog::~PreferenceDialog()
@@ -52,23 +39,22 @@ PreferenceDialog::~PreferenceDialog()
 
 void PreferenceDialog::accept()
 {
-    QSettings settings("tikzit", "tikzit");
+    Preferences *prefs = tikzit->preferences();
     bool ok;
     int i;
 
-    settings.setValue("auto-detect-pdflatex", ui->autoPdflatex->isChecked());
-    settings.setValue("pdflatex-path", ui->pdflatexPath->text());
+    prefs->setAutoDetectPdflatex(ui->autoPdflatex->isChecked());
+    prefs->setPdflatexPath(ui->pdflatexPath->text());
     i = ui->styleIconSpacing->text().toInt(&ok);
-    if (ok) settings.setValue("style-icon-spacing", i);
+    if (ok) prefs->setStyleIconSpacing(i);
 
-    settings.setValue("grid-color-axes", color(ui->axesColor));
-    settings.setValue("grid-color-major", color(ui->majorColor));
-    settings.setValue("grid-color-minor", color(ui->minorColor));
-    settings.setValue("select-new-edges", ui->selectNewEdges->isChecked());
-    settings.setValue("shift-to-scroll", ui->shiftToScroll->isChecked());
-    settings.setValue("source-font", ui->sourceFont->text());
+    prefs->setGridColors(color(ui->minorColor), color(ui->majorColor), color(ui->axesColor));
+    prefs->setSelectNewEdges(ui->selectNewEdges->isChecked());
+    prefs->setShiftToScroll(ui->shiftToScroll->isChecked());
+
+    QFont font;
+    if (font.fromString(ui->sourceFont->text())) prefs->setSourceFont(font);
 
-    tikzit->activeWindow()->setFont();
     QDialog::accept();
 }
 
@@ -108,8 +94,6 @@ void PreferenceDialog::on_autoPdflatex_stateChanged(int state)
 
 void PreferenceDialog::on_browsePdflatex_clicked()
 {
-    QSettings settings("tikzit", "tikzit");
-
     QFileDialog dialog;
     dialog.setWindowTitle(tr("pdflatex Path"));
     dialog.setAcceptMode(QFileDialog::AcceptOpen);
@@ -0,0 +1,201 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "preferences.h"
+
+#include <QSettings>
+
+// delay (in ms) between the last change to a preference and writing it to disk
+#define PREFERENCES_FLUSH_DELAY 1000
+
+Preferences::Preferences(QObject *parent) : QObject(parent)
+{
+    _flushTimer = new QTimer(this);
+    _flushTimer->setSingleShot(true);
+    _flushTimer->setInterval(PREFERENCES_FLUSH_DELAY);
+    connect(_flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+    load();
+}
+
+Preferences::~Preferences()
+{
+    flush();
+}
+
+void Preferences::load()
+{
+    QSettings settings("tikzit", "tikzit");
+    _gridColorMinor = settings.value("grid-color-minor", QColor(250,250,255)).value<QColor>();
+    _gridColorMajor = settings.value("grid-color-major", QColor(240,240,250)).value<QColor>();
+    _gridColorAxes = settings.value("grid-color-axes", QColor(220,220,240)).value<QColor>();
+    _shiftToScroll = settings.value("shift-to-scroll", false).toBool();
+    _selectNewEdges = settings.value("select-new-edges", false).toBool();
+    _smartToolEnabled = settings.value("smart-tool-enabled", true).toBool();
+    _autoDetectPdflatex = settings.value("auto-detect-pdflatex", true).toBool();
+    _pdflatexPath = settings.value("pdflatex-path").toString();
+    _autoPreview = settings.value("auto-preview", false).toBool();
+
+    _sourceFont = QFont("Courier New", 12);
+    if (settings.contains("source-font")) {
+        _sourceFont.fromString(settings.value("source-font").toString());
+    }
+
+    bool ok;
+    _styleIconSpacing = settings.value("style-icon-spacing").toInt(&ok);
+    if (!ok) _styleIconSpacing = 48;
+}
+
+void Preferences::flush()
+{
+    _flushTimer->stop();
+    if (_pending.isEmpty()) return;
+
+    QSettings settings("tikzit", "tikzit");
+    QMapIterator<QString,QVariant> i(_pending);
+    while (i.hasNext()) {
+        i.next();
+        settings.setValue(i.key(), i.value());
+    }
+    _pending.clear();
+}
+
+void Preferences::store(QString key, QVariant value)
+{
+    _pending.insert(key, value);
+    _flushTimer->start();
+}
+
+QColor Preferences::gridColorMinor() const
+{
+    return _gridColorMinor;
+}
+
+QColor Preferences::gridColorMajor() const
+{
+    return _gridColorMajor;
+}
+
+QColor Preferences::gridColorAxes() const
+{
+    return _gridColorAxes;
+}
+
+void Preferences::setGridColors(QColor minor, QColor major, QColor axes)
+{
+    if (minor == _gridColorMinor && major == _gridColorMajor && axes == _gridColorAxes)
+        return;
+    _gridColorMinor = minor;
+    _gridColorMajor = major;
+    _gridColorAxes = axes;
+    store("grid-color-minor", minor);
+    store("grid-color-major", major);
+    store("grid-color-axes", axes);
+    emit gridColorsChanged();
+}
+
+bool Preferences::shiftToScroll() const
+{
+    return _shiftToScroll;
+}
+
+void Preferences::setShiftToScroll(bool shiftToScroll)
+{
+    _shiftToScroll = shiftToScroll;
+    store("shift-to-scroll", shiftToScroll);
+}
+
+bool Preferences::selectNewEdges() const
+{
+    return _selectNewEdges;
+}
+
+void Preferences::setSelectNewEdges(bool selectNewEdges)
+{
+    _selectNewEdges = selectNewEdges;
+    store("select-new-edges", selectNewEdges);
+}
+
+bool Preferences::smartToolEnabled() const
+{
+    return _smartToolEnabled;
+}
+
+void Preferences::setSmartToolEnabled(bool smartToolEnabled)
+{
+    _smartToolEnabled = smartToolEnabled;
+    store("smart-tool-enabled", smartToolEnabled);
+}
+
+bool Preferences::autoPreview() const
+{
+    return _autoPreview;
+}
+
+void Preferences::setAutoPreview(bool autoPreview)
+{
+    _autoPreview = autoPreview;
+    store("auto-preview", autoPreview);
+}
+
+bool Preferences::autoDetectPdflatex() const
+{
+    return _autoDetectPdflatex;
+}
+
+void Preferences::setAutoDetectPdflatex(bool autoDetectPdflatex)
+{
+    _autoDetectPdflatex = autoDetectPdflatex;
+    store("auto-detect-pdflatex", autoDetectPdflatex);
+}
+
+QString Preferences::pdflatexPath() const
+{
+    return _pdflatexPath;
+}
+
+void Preferences::setPdflatexPath(QString pdflatexPath)
+{
+    _pdflatexPath = pdflatexPath;
+    store("pdflatex-path", pdflatexPath);
+}
+
+QFont Preferences::sourceFont() const
+{
+    return _sourceFont;
+}
+
+void Preferences::setSourceFont(QFont sourceFont)
+{
+    if (sourceFont == _sourceFont) return;
+    _sourceFont = sourceFont;
+    store("source-font", sourceFont.toString());
+    emit sourceFontChanged();
+}
+
+int Preferences::styleIconSpacing() const
+{
+    return _styleIconSpacing;
+}
+
+void Preferences::setStyleIconSpacing(int styleIconSpacing)
+{
+    if (styleIconSpacing == _styleIconSpacing) return;
+    _styleIconSpacing = styleIconSpacing;
+    store("style-icon-spacing", styleIconSpacing);
+    emit styleIconSpacingChanged();
+}
@@ -0,0 +1,106 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*!
+ * An in-memory copy of the user preferences which are read from event handlers
+ * and paint code. Values are loaded from QSettings once, at startup. Setters
+ * update the cached value immediately and emit a change signal, but the write
+ * back to QSettings is coalesced and happens on a timer, so it never runs on
+ * the interaction path.
+ */
+
+#ifndef PREFERENCES_H
+#define PREFERENCES_H
+
+#include <QObject>
+#include <QColor>
+#include <QFont>
+#include <QString>
+#include <QVariant>
+#include <QMap>
+#include <QTimer>
+
+class Preferences : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Preferences(QObject *parent = nullptr);
+    ~Preferences() override;
+    void load();
+
+    QColor gridColorMinor() const;
+    QColor gridColorMajor() const;
+    QColor gridColorAxes() const;
+    void setGridColors(QColor minor, QColor major, QColor axes);
+
+    bool shiftToScroll() const;
+    void setShiftToScroll(bool shiftToScroll);
+
+    bool selectNewEdges() const;
+    void setSelectNewEdges(bool selectNewEdges);
+
+    bool smartToolEnabled() const;
+    void setSmartToolEnabled(bool smartToolEnabled);
+
+    bool autoDetectPdflatex() const;
+    void setAutoDetectPdflatex(bool autoDetectPdflatex);
+
+    QString pdflatexPath() const;
+    void setPdflatexPath(QString pdflatexPath);
+
+    bool autoPreview() const;
+    void setAutoPreview(bool autoPreview);
+
+    QFont sourceFont() const;
+    void setSourceFont(QFont sourceFont);
+
+    int styleIconSpacing() const;
+    void setStyleIconSpacing(int styleIconSpacing);
+
+public slots:
+    /*!
+     * \brief flush writes any pending changes back to QSettings. This is called
+     * automatically shortly after the last change, and on shutdown.
+     */
+    void flush();
+
+signals:
+    void gridColorsChanged();
+    void sourceFontChanged();
+    void styleIconSpacingChanged();
+
+private:
+    void store(QString key, QVariant value);
+
+    QColor _gridColorMinor;
+    QColor _gridColorMajor;
+    QColor _gridColorAxes;
+    bool _shiftToScroll;
+    bool _selectNewEdges;
+    bool _smartToolEnabled;
+    bool _autoDetectPdflatex;
+    QString _pdflatexPath;
+    bool _autoPreview;
+    QFont _sourceFont;
+    int _styleIconSpacing;
+
+    QMap<QString,QVariant> _pending;
+    QTimer *_flushTimer;
+};
+
+#endif // PREFERENCES_H
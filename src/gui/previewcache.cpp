@@ -0,0 +1,90 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "previewcache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+QString PreviewCache::lookup(QByteArray key)
+{
+    QString dir = cacheDir();
+    if (dir.isEmpty()) return QString();
+
+    QString path = dir + "/" + fileName(key);
+    QFile f(path);
+    if (!f.exists()) return QString();
+
+    // the modification time doubles as the time of last use
+    if (f.open(QIODevice::ReadWrite)) {
+        f.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        f.close();
+    }
+
+    return path;
+}
+
+void PreviewCache::insert(QByteArray key, QString pdf)
+{
+    QString dir = cacheDir();
+    if (dir.isEmpty()) return;
+
+    // copy under a temporary name first, so another instance of TikZiT never sees
+    // a half-written PDF
+    QString path = dir + "/" + fileName(key);
+    QString tmp = path + ".tmp";
+    QFile::remove(tmp);
+    if (!QFile::copy(pdf, tmp)) return;
+    QFile::remove(path);
+    if (!QFile::rename(tmp, path)) {
+        QFile::remove(tmp);
+        return;
+    }
+
+    evict();
+}
+
+QString PreviewCache::cacheDir()
+{
+    QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (path.isEmpty()) return QString();
+    path += "/previews";
+    if (!QDir().mkpath(path)) return QString();
+    return path;
+}
+
+QString PreviewCache::fileName(QByteArray key)
+{
+    return QString::fromLatin1(key.toHex()) + ".pdf";
+}
+
+void PreviewCache::evict()
+{
+    QDir dir(cacheDir());
+    QFileInfoList files = dir.entryInfoList(QStringList() << "*.pdf", QDir::Files, QDir::Time);
+
+    // files are sorted from the most to the least recently used
+    qint64 total = 0;
+    foreach (QFileInfo fi, files) {
+        total += fi.size();
+        if (total > PREVIEW_CACHE_MAX_BYTES) dir.remove(fi.fileName());
+    }
+}
@@ -0,0 +1,55 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*!
+ * An on-disk cache of preview PDFs, keyed by a hash of everything that goes
+ * into the preview. It lives in the user's cache directory, so it is shared
+ * by all windows and survives between sessions. When it grows beyond
+ * PREVIEW_CACHE_MAX_BYTES, the least recently used PDFs are removed.
+ */
+
+#ifndef PREVIEWCACHE_H
+#define PREVIEWCACHE_H
+
+#include <QByteArray>
+#include <QString>
+
+#define PREVIEW_CACHE_MAX_BYTES (64 * 1024 * 1024)
+
+class PreviewCache
+{
+public:
+    /*!
+     * \brief lookup returns the path of the cached PDF with the given key, or an
+     * empty string if there is none. A hit counts as a use of that PDF.
+     */
+    static QString lookup(QByteArray key);
+
+    /*!
+     * \brief insert stores a copy of the given PDF under the given key, and evicts
+     * old entries if the cache has grown too big.
+     */
+    static void insert(QByteArray key, QString pdf);
+
+private:
+    static QString cacheDir();
+    static QString fileName(QByteArray key);
+    static void evict();
+};
+
+#endif // PREVIEWCACHE_H
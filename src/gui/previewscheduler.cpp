@@ -0,0 +1,168 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "previewscheduler.h"
+
+#include <QThread>
+
+PreviewScheduler::PreviewScheduler(PreviewWindow *preview, QObject *parent) : QObject(parent)
+{
+    _preview = preview;
+    _active = nullptr;
+    _maxJobs = qMax(1, QThread::idealThreadCount());
+    _scheduling = false;
+}
+
+void PreviewScheduler::request(MainWindow *doc, QString tikz, QByteArray key, bool force)
+{
+    // nothing TeX would see has changed, so the last preview still stands
+    if (!force && _keys.contains(doc) && _keys.value(doc) == key) return;
+    _keys.insert(doc, key);
+
+    // a preview that is still going is for an older state of the document
+    LatexProcess *job = _jobs.value(doc, nullptr);
+    if (job != nullptr && _running.contains(job)) {
+        _jobs.remove(doc);
+        stop(job);
+    }
+
+    _pending.insert(doc, tikz);
+    if (!_queue.contains(doc)) _queue << doc;
+    schedule();
+}
+
+void PreviewScheduler::setActiveDocument(MainWindow *doc)
+{
+    if (doc == _active) return;
+
+    LatexProcess *job = _jobs.value(_active, nullptr);
+    if (job != nullptr) job->setAttached(false);
+
+    _active = doc;
+    job = _jobs.value(_active, nullptr);
+    if (job != nullptr) {
+        job->setAttached(true);
+    } else {
+        _preview->outputTextEdit()->clear();
+        _preview->clearPdf();
+    }
+}
+
+void PreviewScheduler::removeDocument(MainWindow *doc)
+{
+    _pending.remove(doc);
+    _keys.remove(doc);
+    _queue.removeAll(doc);
+    if (doc == _active) _active = nullptr;
+
+    LatexProcess *job = _jobs.take(doc);
+    if (job != nullptr) {
+        stop(job);
+        schedule();
+    }
+}
+
+int PreviewScheduler::maxJobs() const
+{
+    return _maxJobs;
+}
+
+void PreviewScheduler::jobFinished()
+{
+    LatexProcess *job = qobject_cast<LatexProcess*>(sender());
+    if (job == nullptr) return;
+    _running.remove(job);
+    schedule();
+}
+
+void PreviewScheduler::schedule()
+{
+    // previews served from the cache finish straight away, and call back into here
+    if (_scheduling) return;
+    _scheduling = true;
+
+    // the active document comes first, then submitted jobs, then other documents
+    while (_running.size() < _maxJobs && !(_queue.isEmpty() && _submitted.isEmpty())) {
+        if (!_queue.contains(_active) && !_submitted.isEmpty()) {
+            startSubmitted(_submitted.takeFirst());
+            continue;
+        }
+
+        MainWindow *doc = _queue.contains(_active) ? _active : _queue.first();
+        _queue.removeAll(doc);
+        start(doc, _pending.take(doc));
+    }
+
+    _scheduling = false;
+}
+
+void PreviewScheduler::start(MainWindow *doc, QString tikz)
+{
+    LatexProcess *old = _jobs.value(doc, nullptr);
+    if (old != nullptr) stop(old);
+
+    LatexProcess *job = new LatexProcess(_preview, this);
+    job->setAttached(doc == _active);
+    _jobs.insert(doc, job);
+    _running << job;
+    connect(job, SIGNAL(previewFinished()), this, SLOT(jobFinished()));
+
+    job->makePreview(tikz);
+}
+
+void PreviewScheduler::submit(LatexProcess *job, QStringList figures, bool batch)
+{
+    job->setAttached(false);
+    _submitted << job;
+    _submittedFigures.insert(job, figures);
+    if (batch) _submittedBatches << job;
+    schedule();
+}
+
+void PreviewScheduler::withdraw(LatexProcess *job)
+{
+    _submitted.removeAll(job);
+    _submittedFigures.remove(job);
+    _submittedBatches.remove(job);
+    if (_running.contains(job)) {
+        disconnect(job, nullptr, this, nullptr);
+        job->kill();
+        _running.remove(job);
+        schedule();
+    }
+}
+
+void PreviewScheduler::startSubmitted(LatexProcess *job)
+{
+    QStringList figures = _submittedFigures.take(job);
+    bool batch = _submittedBatches.contains(job);
+    _submittedBatches.remove(job);
+
+    _running << job;
+    connect(job, SIGNAL(previewFinished()), this, SLOT(jobFinished()));
+    if (batch) job->makeBatch(figures);
+    else job->makePreview(figures.value(0));
+}
+
+void PreviewScheduler::stop(LatexProcess *job)
+{
+    disconnect(job, nullptr, this, nullptr);
+    job->kill();
+    job->deleteLater();
+    _running.remove(job);
+}
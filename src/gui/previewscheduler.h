@@ -0,0 +1,120 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*!
+ * Runs previews for several documents at once. Each document has at most one
+ * preview queued and one running; a newer request for a document replaces the
+ * queued one and stops the running one. Up to maxJobs() previews run at the
+ * same time, each in its own working directory, and the active document is
+ * always started first.
+ *
+ * There is a single PreviewWindow, which shows the latest preview of the
+ * active document. The previews of other documents keep their results, so
+ * switching documents brings their preview straight back.
+ *
+ * Jobs that don't belong to a document, such as figure batches, share the
+ * same limit on running jobs, but are never shown in the preview window.
+ */
+
+#ifndef PREVIEWSCHEDULER_H
+#define PREVIEWSCHEDULER_H
+
+#include "latexprocess.h"
+#include "previewwindow.h"
+
+#include <QObject>
+#include <QMap>
+#include <QList>
+#include <QSet>
+#include <QStringList>
+
+class MainWindow;
+
+class PreviewScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PreviewScheduler(PreviewWindow *preview, QObject *parent = nullptr);
+
+    /*!
+     * \brief request queues a preview of the given tikz source for a document.
+     * Unless force is set, nothing happens if the given key (see Graph::texKey) is
+     * the same as for the last request for the document.
+     */
+    void request(MainWindow *doc, QString tikz, QByteArray key, bool force = false);
+
+    /*!
+     * \brief setActiveDocument makes the preview window show the given document,
+     * and gives its previews priority.
+     */
+    void setActiveDocument(MainWindow *doc);
+
+    /*!
+     * \brief removeDocument drops any previews of a document that is being closed.
+     */
+    void removeDocument(MainWindow *doc);
+
+    /*!
+     * \brief maxJobs is the number of previews that may run at the same time,
+     * which is the number of processor cores.
+     */
+    int maxJobs() const;
+
+    /*!
+     * \brief submit queues a job that doesn't belong to a document. Once it may
+     * run, it typesets the given figures with LatexProcess::makeBatch(), or the
+     * single given figure with LatexProcess::makePreview() if batch is false. The
+     * caller keeps ownership of the job, and learns that it is done from its
+     * previewFinished() signal.
+     */
+    void submit(LatexProcess *job, QStringList figures, bool batch);
+
+    /*!
+     * \brief withdraw removes a submitted job from the queue, or stops it if it is
+     * running.
+     */
+    void withdraw(LatexProcess *job);
+
+private slots:
+    void jobFinished();
+
+private:
+    void schedule();
+    void start(MainWindow *doc, QString tikz);
+    void startSubmitted(LatexProcess *job);
+    void stop(LatexProcess *job);
+
+    PreviewWindow *_preview;
+    MainWindow *_active;
+    QMap<MainWindow*,QString> _pending;
+    QMap<MainWindow*,QByteArray> _keys;
+    QList<MainWindow*> _queue;
+
+    // the latest preview of each document, which may have finished already
+    QMap<MainWindow*,LatexProcess*> _jobs;
+    QSet<LatexProcess*> _running;
+
+    // submitted jobs waiting to run, with the figures they typeset
+    QList<LatexProcess*> _submitted;
+    QMap<LatexProcess*,QStringList> _submittedFigures;
+    QSet<LatexProcess*> _submittedBatches;
+    int _maxJobs;
+    bool _scheduling;
+};
+
+#endif // PREVIEWSCHEDULER_H
@@ -36,6 +36,7 @@
 #include <cmath>
 #include <QMovie>
 #include <QAction>
+#include <QFileInfo>
 
 PreviewWindow::PreviewWindow(QWidget *parent) :
     QDialog(parent),
@@ -44,8 +45,13 @@ PreviewWindow::PreviewWindow(QWidget *parent) :
 
     ui->setupUi(this);
 
+    // old output is dropped as new output arrives, like LatexProcess does
+    ui->output->setMaximumBlockCount(LATEX_LOG_MAX_LINES);
+
     _positionRestored = false;
     _doc = nullptr;
+    _tiffExport = nullptr;
+    _tiffProgress = nullptr;
 
     _loader = new QLabel(ui->tabWidget->tabBar());
     _loader->setMinimumSize(QSize(16,16));
@@ -82,6 +88,10 @@ PdfDocument *PreviewWindow::doc() const
 
 PreviewWindow::~PreviewWindow()
 {
+    if (_tiffExport != nullptr) {
+        _tiffExport->cancel();
+        _tiffExport->wait();
+    }
     delete ui;
 }
 
@@ -121,12 +131,21 @@ void PreviewWindow::setPdf(QString file)
     }
 }
 
+void PreviewWindow::clearPdf()
+{
+    if (_doc != nullptr) {
+        delete _doc;
+        _doc = nullptr;
+    }
+    ui->pdf->clear();
+}
+
 QPlainTextEdit *PreviewWindow::outputTextEdit()
 {
     return ui->output;
 }
 
-void PreviewWindow::setStatus(PreviewWindow::Status status)
+void PreviewWindow::setStatus(PreviewWindow::Status status, qint64 elapsed)
 {
     QMovie *oldMovie = _loader->movie();
     if (status == PreviewWindow::Running) {
@@ -153,6 +172,13 @@ void PreviewWindow::setStatus(PreviewWindow::Status status)
 
     if (oldMovie != nullptr) oldMovie->deleteLater();
 
+    if (status == PreviewWindow::Running) {
+        _loader->setToolTip("Running pdflatex...");
+    } else if (elapsed >= 0) {
+        QString time = QString::number(elapsed / 1000.0, 'f', 2) + " s";
+        _loader->setToolTip((status == PreviewWindow::Success ? "Finished in " : "Failed after ") + time);
+        setWindowTitle("Preview (" + time + ")");
+    }
 
     _loader->repaint();
 }
@@ -192,13 +218,17 @@ void PreviewWindow::render() {
 void PreviewWindow::exportImage()
 {
     QSettings settings("tikzit", "tikzit");
-    if (_doc == nullptr) return;
+    if (_doc == nullptr || _tiffExport != nullptr) return;
     ExportDialog *d = new ExportDialog(this);
     int ret = d->exec();
     if (ret == QDialog::Accepted) {
         bool success;
         if (d->fileFormat() == ExportDialog::PDF) {
             success = _doc->exportPdf(d->filePath());
+        } else if (d->fileFormat() == ExportDialog::TIFF) {
+            // large TIFF images can take a while, so they are written in the background
+            exportTiff(d->filePath(), d->size());
+            return;
         } else {
             success = _doc->exportImage(
                         d->filePath(),
@@ -206,15 +236,53 @@ void PreviewWindow::exportImage()
                         d->size());
         }
 
-        if (!success) {
-            QMessageBox::warning(this,
-                "Error",
-                "Could not write to: '" + d->filePath() +
-                   "'. Check file permissions or choose a new location.");
-        }
+        if (!success) warnExportFailed(d->filePath());
     }
 }
 
+void PreviewWindow::exportTiff(QString file, QSize size)
+{
+    _tiffExport = _doc->exportTiff(file, size, this);
+    if (_tiffExport == nullptr) {
+        warnExportFailed(file);
+        return;
+    }
+
+    _tiffProgress = new QProgressDialog(tr("Exporting %1...").arg(QFileInfo(file).fileName()),
+                                        tr("Cancel"), 0, _tiffExport->outputSize().height(), this);
+    _tiffProgress->setWindowTitle(tr("Export Image"));
+    _tiffProgress->setWindowModality(Qt::WindowModal);
+    _tiffProgress->setAutoClose(false);
+    _tiffProgress->setAutoReset(false);
+    _tiffProgress->setValue(0);
+    connect(_tiffProgress, SIGNAL(canceled()), _tiffExport, SLOT(cancel()));
+    connect(_tiffExport, SIGNAL(progress(int)), _tiffProgress, SLOT(setValue(int)));
+    connect(_tiffExport, SIGNAL(finished()), this, SLOT(tiffExportFinished()));
+    _tiffExport->start();
+}
+
+void PreviewWindow::tiffExportFinished()
+{
+    disconnect(_tiffProgress, nullptr, _tiffExport, nullptr);
+    _tiffProgress->hide();
+    _tiffProgress->deleteLater();
+    _tiffProgress = nullptr;
+
+    if (!_tiffExport->succeeded() && !_tiffExport->wasCancelled())
+        warnExportFailed(_tiffExport->file());
+
+    _tiffExport->deleteLater();
+    _tiffExport = nullptr;
+}
+
+void PreviewWindow::warnExportFailed(QString file)
+{
+    QMessageBox::warning(this,
+        "Error",
+        "Could not write to: '" + file +
+           "'. Check file permissions or choose a new location.");
+}
+
 void PreviewWindow::copyImageToClipboard()
 {
     if (_doc != nullptr) {
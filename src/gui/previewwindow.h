@@ -30,6 +30,7 @@
 #include <QLabel>
 #include <QPlainTextEdit>
 #include <QContextMenuEvent>
+#include <QProgressDialog>
 
 namespace Ui {
 class PreviewWindow;
@@ -47,9 +48,15 @@ public:
     ~PreviewWindow() override;
     void restorePosition();
     void setPdf(QString file);
+    void clearPdf();
     QString preparePreview(QString tikz);
     QPlainTextEdit *outputTextEdit();
-    void setStatus(Status status);
+
+    /*!
+     * \brief setStatus updates the status icon. For a finished preview, the time it
+     * took in ms can be given, which is then shown with the status.
+     */
+    void setStatus(Status status, qint64 elapsed = -1);
 
     PdfDocument *doc() const;
 
@@ -57,6 +64,7 @@ public slots:
     void render();
     void exportImage();
     void copyImageToClipboard();
+    void tiffExportFinished();
 
 protected:
     void changeEvent(QEvent* e) override;
@@ -69,6 +77,10 @@ private:
     PdfDocument *_doc;
     QLabel *_loader;
     bool _positionRestored;
+    TiledExport *_tiffExport;
+    QProgressDialog *_tiffProgress;
+    void exportTiff(QString file, QSize size);
+    void warnExportFailed(QString file);
 };
 
 #endif // PREVIEWWINDOW_H
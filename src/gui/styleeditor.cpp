@@ -19,7 +19,6 @@
 #include <QColorDialog>
 #include <QDebug>
 #include <QMessageBox>
-#include <QSettings>
 
 #include "tikzit.h"
 #include "styleeditor.h"
@@ -32,10 +31,7 @@ StyleEditor::StyleEditor(QWidget *parent) :
     ui(new Ui::StyleEditor)
 {
     ui->setupUi(this);
-    QSettings settings("tikzit", "tikzit");
-    bool ok;
-    int space = settings.value("style-icon-spacing").toInt(&ok);
-    if (!ok) space = 48;
+    int space = tikzit->preferences()->styleIconSpacing();
 
     _formWidgets << ui->name << ui->category <<
         ui->fillColor << ui->noFill << ui->hasTikzitFillColor << ui->tikzitFillColor <<
@@ -64,6 +60,9 @@ StyleEditor::StyleEditor(QWidget *parent) :
     ui->edgeStyleListView->setMovement(QListView::Static);
     ui->edgeStyleListView->setGridSize(QSize(space,space));
 
+    connect(tikzit->preferences(), SIGNAL(styleIconSpacingChanged()),
+            this, SLOT(refreshIconSpacing()));
+
     connect(ui->category->lineEdit(),
             SIGNAL(editingFinished()),
             this, SLOT(categoryChanged()));
@@ -810,10 +809,7 @@ Style *StyleEditor::activeStyle()
 void StyleEditor::refreshActiveStyle()
 {
     if (_styles != nullptr) {
-        QSettings settings("tikzit", "tikzit");
-        bool ok;
-        int space = settings.value("style-icon-spacing").toInt(&ok);
-        if (!ok) space = 48;
+        int space = tikzit->preferences()->styleIconSpacing();
 
         if (_nodeStyleIndex.isValid()) {
             emit _styles->nodeStyles()->dataChanged(_nodeStyleIndex, _nodeStyleIndex);
@@ -831,6 +827,13 @@ void StyleEditor::refreshActiveStyle()
     }
 }
 
+void StyleEditor::refreshIconSpacing()
+{
+    int space = tikzit->preferences()->styleIconSpacing();
+    ui->styleListView->setGridSize(QSize(space,space));
+    ui->edgeStyleListView->setGridSize(QSize(space,space));
+}
+
 void StyleEditor::updateColor(QPushButton *btn, QString name, QString propName)
 {
     QColor col = QColorDialog::getColor(
@@ -97,6 +97,7 @@ public slots:
 
     void on_currentCategory_currentIndexChanged(int);
 
+    void refreshIconSpacing();
 
 private:
     Ui::StyleEditor *ui;
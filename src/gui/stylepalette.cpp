@@ -34,10 +34,7 @@ StylePalette::StylePalette(QWidget *parent) :
     ui(new Ui::StylePalette)
 {
     ui->setupUi(this);
-    QSettings settings("tikzit", "tikzit");
-    bool ok;
-    int space = settings.value("style-icon-spacing").toInt(&ok);
-    if (!ok) space = 48;
+    int space = tikzit->preferences()->styleIconSpacing();
     _lastStyleIndex = 0;
     _lastEdgeStyleIndex = 0;
 
@@ -56,6 +53,7 @@ StylePalette::StylePalette(QWidget *parent) :
 
     connect(ui->styleListView, SIGNAL(doubleClicked(const QModelIndex &)), this, SLOT( nodeStyleDoubleClicked(const QModelIndex&)) );
 	connect(ui->edgeStyleListView, SIGNAL(doubleClicked(const QModelIndex &)), this, SLOT(edgeStyleDoubleClicked(const QModelIndex&)));
+    connect(tikzit->preferences(), SIGNAL(styleIconSpacingChanged()), this, SLOT(refreshIconSpacing()));
 }
 
 StylePalette::~StylePalette()
@@ -246,10 +244,12 @@ void StylePalette::on_currentCategory_currentTextChanged(const QString &cat)
 void StylePalette::resizeEvent(QResizeEvent *event)
 {
     QDockWidget::resizeEvent(event);
-    QSettings settings("tikzit", "tikzit");
-    bool ok;
-    int space = settings.value("style-icon-spacing").toInt(&ok);
-    if (!ok) space = 48;
+    refreshIconSpacing();
+}
+
+void StylePalette::refreshIconSpacing()
+{
+    int space = tikzit->preferences()->styleIconSpacing();
     ui->styleListView->setGridSize(QSize(space,space));
     ui->edgeStyleListView->setGridSize(QSize(space,space));
 }
@@ -53,6 +53,7 @@ public slots:
     void on_buttonRefreshTikzstyles_clicked();
     void on_currentCategory_currentTextChanged(const QString &cat);
     //void on_buttonApplyNodeStyle_clicked();
+    void refreshIconSpacing();
 
 private:
     int _lastStyleIndex;
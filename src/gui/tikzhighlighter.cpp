@@ -0,0 +1,175 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "tikzhighlighter.h"
+
+#include "tikzparserdefs.h"
+#include "tikzparser.parser.hpp"
+#include "tikzlexer.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// the block state packs the lexer's start condition together with the depth of
+// an unclosed {...} string
+#define LEXER_CONDITION_BITS 4
+#define LEXER_CONDITION_MASK 0xf
+
+TikzHighlighter::TikzHighlighter(QTextDocument *parent) : QSyntaxHighlighter(parent)
+{
+    yylex_init(&_scanner);
+
+    _commandFormat.setForeground(QColor(0,0,180));
+    _commandFormat.setFontWeight(QFont::Bold);
+    _keywordFormat.setForeground(QColor(0,0,180));
+    _coordFormat.setForeground(QColor(0,120,120));
+    _propertyFormat.setForeground(QColor(0,120,0));
+    _nodeRefFormat.setForeground(QColor(130,0,130));
+    _stringFormat.setForeground(QColor(160,0,0));
+    _commentFormat.setForeground(QColor(128,128,128));
+    _commentFormat.setFontItalic(true);
+}
+
+TikzHighlighter::~TikzHighlighter()
+{
+    yylex_destroy(_scanner);
+}
+
+void TikzHighlighter::highlightBlock(const QString &text)
+{
+    int state = previousBlockState();
+    if (state < 0) state = 0;
+    int condition = state & LEXER_CONDITION_MASK;
+    int depth = state >> LEXER_CONDITION_BITS;
+
+    // the parser reads latin1, so the lexer's offsets are also character offsets
+    QByteArray bytes = text.toLatin1();
+    int pos = 0;
+
+    // finish a {...} string left open by the previous line
+    if (depth > 0) {
+        pos = skipDelimited(bytes, 0, depth);
+        setFormat(0, pos, _stringFormat);
+        if (depth > 0) {
+            setCurrentBlockState(condition | (depth << LEXER_CONDITION_BITS));
+            return;
+        }
+    }
+
+    // comments are only recognised when they are followed by a newline
+    QByteArray input = bytes.mid(pos) + '\n';
+    YY_BUFFER_STATE buf = yy_scan_bytes(input.constData(), input.size(), _scanner);
+    tikzlexer_set_start_condition(_scanner, condition);
+
+    YYSTYPE lval;
+    YYLTYPE lloc;
+    std::memset(&lloc, 0, sizeof(lloc));
+    int prevEnd = pos;
+    int token;
+    while ((token = yylex(&lval, &lloc, _scanner)) != 0) {
+        int start, end;
+        tikzlexer_token_range(_scanner, &start, &end);
+        start += pos;
+        end = qMin(end + pos, bytes.size());
+
+        switch (token) {
+        case BEGIN_TIKZPICTURE_CMD:
+        case END_TIKZPICTURE_CMD:
+        case TIKZSTYLE_CMD:
+        case BEGIN_PGFONLAYER_CMD:
+        case END_PGFONLAYER_CMD:
+        case DRAW_CMD:
+        case NODE_CMD:
+        case PATH_CMD:
+        case UNKNOWN_BEGIN_CMD:
+        case UNKNOWN_END_CMD:
+        case UNKNOWN_CMD:
+            setFormat(start, end - start, _commandFormat);
+            break;
+        case RECTANGLE:
+        case NODE:
+        case AT:
+        case TO:
+        case CYCLE:
+            setFormat(start, end - start, _keywordFormat);
+            break;
+        case TCOORD:
+            // the token itself is just the closing parenthesis, so go back to the opening one
+            delete lval.pt;
+            start = bytes.lastIndexOf('(', start);
+            if (start < prevEnd) start = prevEnd;
+            setFormat(start, end - start, _coordFormat);
+            break;
+        case PROPSTRING:
+            free(lval.str);
+            setFormat(start, end - start, _propertyFormat);
+            break;
+        case REFSTRING:
+            free(lval.str);
+            setFormat(start, end - start, _nodeRefFormat);
+            break;
+        case DELIMITEDSTRING:
+            free(lval.str);
+            setFormat(start, end - start, _stringFormat);
+            break;
+        case UNCLOSED_DELIM_STR:
+            depth = 1;
+            skipDelimited(bytes, start + 1, depth);
+            setFormat(start, bytes.size() - start, _stringFormat);
+            break;
+        }
+
+        highlightComment(bytes, prevEnd, start);
+        prevEnd = end;
+        if (token == UNCLOSED_DELIM_STR) break;
+    }
+
+    if (depth == 0) highlightComment(bytes, prevEnd, bytes.size());
+    condition = tikzlexer_start_condition(_scanner);
+    yy_delete_buffer(buf, _scanner);
+
+    setCurrentBlockState(condition | (depth << LEXER_CONDITION_BITS));
+}
+
+int TikzHighlighter::skipDelimited(const QByteArray &bytes, int pos, int &depth) const
+{
+    // follows the rule for "{" in tikzlexer.l
+    bool escape = false;
+    for (; pos < bytes.size(); ++pos) {
+        char c = bytes[pos];
+        if (escape) {
+            escape = false;
+        } else if (c == '\\') {
+            escape = true;
+        } else if (c == '{') {
+            depth++;
+        } else if (c == '}') {
+            depth--;
+            if (depth == 0) return pos + 1;
+        }
+    }
+    return pos;
+}
+
+void TikzHighlighter::highlightComment(const QByteArray &bytes, int start, int end)
+{
+    // the lexer skips comments without producing a token, so they can only be
+    // found in the gaps between tokens
+    int i = bytes.indexOf('%', start);
+    if (i != -1 && i < end) setFormat(i, bytes.size() - i, _commentFormat);
+}
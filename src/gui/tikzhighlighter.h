@@ -0,0 +1,58 @@
+/*
+    TikZiT - a GUI diagram editor for TikZ
+    Copyright (C) 2018 Aleks Kissinger
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*!
+ * Syntax highlighting for the TikZ source view. Each line is run through the
+ * same lexer that is used for parsing, starting in the lexer state that the
+ * previous line ended in. That state, along with the depth of any {...} string
+ * that is still open, is stored as the block state, so after an edit only the
+ * edited lines are rescanned, plus the lines after them for as long as their
+ * starting state changes.
+ */
+
+#ifndef TIKZHIGHLIGHTER_H
+#define TIKZHIGHLIGHTER_H
+
+#include <QSyntaxHighlighter>
+#include <QTextCharFormat>
+
+class TikzHighlighter : public QSyntaxHighlighter
+{
+    Q_OBJECT
+public:
+    explicit TikzHighlighter(QTextDocument *parent);
+    ~TikzHighlighter() override;
+
+protected:
+    void highlightBlock(const QString &text) override;
+
+private:
+    int skipDelimited(const QByteArray &bytes, int pos, int &depth) const;
+    void highlightComment(const QByteArray &bytes, int start, int end);
+
+    void *_scanner;
+    QTextCharFormat _commandFormat;
+    QTextCharFormat _keywordFormat;
+    QTextCharFormat _coordFormat;
+    QTextCharFormat _propertyFormat;
+    QTextCharFormat _nodeRefFormat;
+    QTextCharFormat _stringFormat;
+    QTextCharFormat _commentFormat;
+};
+
+#endif // TIKZHIGHLIGHTER_H
@@ -28,9 +28,24 @@
 #include <QClipboard>
 #include <QInputDialog>
 #include <QMessageBox>
+#include <QScreen>
+#include <QGuiApplication>
 #include <cmath>
+#include <algorithm>
 #include <delimitedstringvalidator.h>
-#include <QSettings>
+
+// graphs with more elements than this only create items near the visible region
+#define VIRTUALIZE_THRESHOLD 5000
+
+// maximum number of unused node/edge items kept around for re-use
+#define ITEM_POOL_SIZE 512
+
+// maximum number of node and edge items a virtualized scene creates near the view
+#define MATERIALIZE_MAX_ITEMS 2000
+
+// nodes are always drawn above edges, and the first edge of a path just above the path
+#define NODE_Z_OFFSET 1.0e9
+#define PATH_EDGE_Z_OFFSET 0.00001
 
 
 TikzScene::TikzScene(TikzDocument *tikzDocument, ToolPalette *tools,
@@ -39,7 +54,48 @@ TikzScene::TikzScene(TikzDocument *tikzDocument, ToolPalette *tools,
 {
     _modifyEdgeItem = nullptr;
     _edgeStartNodeItem = nullptr;
+    _edgeEndNodeItem = nullptr;
     _drawNodeLabels = true;
+    _fastRendering = false;
+    _virtualized = false;
+    _recycling = false;
+    _materializeTimer = new QTimer(this);
+    _materializeTimer->setSingleShot(true);
+    _materializeTimer->setInterval(0);
+    connect(_materializeTimer, SIGNAL(timeout()), this, SLOT(materializeVisible()));
+
+    // coalesce drag updates to one per frame of the display
+    qreal refreshRate = 60.0;
+    if (QScreen *screen = QGuiApplication::primaryScreen()) {
+        if (screen->refreshRate() > 0.0) refreshRate = screen->refreshRate();
+    }
+    _dragTimer = new QTimer(this);
+    _dragTimer->setSingleShot(true);
+    _dragTimer->setTimerType(Qt::PreciseTimer);
+    _dragTimer->setInterval(static_cast<int>(1000.0 / refreshRate));
+    connect(_dragTimer, SIGNAL(timeout()), this, SLOT(applyDrag()));
+
+    // selection changes are reported in one batch, once control returns to the event loop
+    _selectionTimer = new QTimer(this);
+    _selectionTimer->setSingleShot(true);
+    _selectionTimer->setInterval(0);
+    connect(_selectionTimer, SIGNAL(timeout()), this, SIGNAL(selectedElementsChanged()));
+
+    _dirtyTimer = new QTimer(this);
+    _dirtyTimer->setSingleShot(true);
+    _dirtyTimer->setInterval(0);
+    connect(_dirtyTimer, SIGNAL(timeout()), this, SLOT(discardDirtyRegion()));
+
+    // refreshes requested by undo commands are flushed when the undo stack finishes an
+    // operation. The timer is a fallback, in case the stack doesn't report one.
+    _refreshPending = false;
+    _refreshTimer = new QTimer(this);
+    _refreshTimer->setSingleShot(true);
+    _refreshTimer->setInterval(0);
+    connect(_refreshTimer, SIGNAL(timeout()), this, SLOT(flushRefresh()));
+    if (_tikzDocument) {
+        connect(_tikzDocument->undoStack(), SIGNAL(indexChanged(int)), this, SLOT(flushRefresh()));
+    }
     _drawEdgeItem = new QGraphicsLineItem();
     _rubberBandItem = new QGraphicsRectItem();
     _enabled = true;
@@ -75,6 +131,8 @@ TikzScene::TikzScene(TikzDocument *tikzDocument, ToolPalette *tools,
 }
 
 TikzScene::~TikzScene() {
+    qDeleteAll(_nodeItemPool);
+    qDeleteAll(_edgeItemPool);
 }
 
 Graph *TikzScene::graph()
@@ -82,49 +140,131 @@ Graph *TikzScene::graph()
     return _tikzDocument->graph();
 }
 
+// Key used to match edges between an old and a new graph. Edges with the same endpoints
+// are further distinguished by their relative order in the graph.
+static QPair<QString,QString> edgeKey(Edge *e)
+{
+    return QPair<QString,QString>(e->source()->name(), e->target()->name());
+}
+
 void TikzScene::graphReplaced()
 {
+    _index.invalidate();
 
-	foreach (NodeItem *ni, _nodeItems) {
-        removeItem(ni);
-        delete ni;
+    // elements without items belong to the old graph. Those with items are matched
+    // below, or deselected as their items leave the scene.
+    deselectWithoutItems();
+
+    // edges captured for an in-progress drag may no longer exist
+    _dragEdges.clear();
+    _dragPaths.clear();
+
+    _virtualized = graph()->nodes().size() + graph()->edges().size() > VIRTUALIZE_THRESHOLD;
+
+    if (_virtualized) {
+        // items are created on demand for the visible region, so there is nothing
+        // to reconcile
+        clearItems();
+        refreshZIndices();
+        materializeVisible();
+        refreshSceneBounds();
+        return;
     }
-    _nodeItems.clear();
 
-    foreach (EdgeItem *ei, _edgeItems) {
-        removeItem(ei);
-        delete ei;
+    // Rather than throwing away all of the graphics items, match up elements of the new
+    // graph with those of the old one. Nodes are matched by name, and edges by the names
+    // of their endpoints and their order among edges with the same endpoints. Matched
+    // items are rebound to the new elements in place, which keeps their selection state,
+    // and only elements that actually appeared or disappeared create or destroy items.
+
+    QMultiHash<QString,NodeItem*> oldNodeItems;
+    foreach (NodeItem *ni, _nodeItems) oldNodeItems.insert(ni->node()->name(), ni);
+
+    // old edge items grouped by endpoints, in their old order (which is reflected by z-value)
+    QMap<QPair<QString,QString>,QList<EdgeItem*>> oldEdgeItems;
+    foreach (EdgeItem *ei, _edgeItems) oldEdgeItems[edgeKey(ei->edge())] << ei;
+    for (auto it = oldEdgeItems.begin(); it != oldEdgeItems.end(); ++it) {
+        std::sort(it.value().begin(), it.value().end(),
+                  [](EdgeItem *a, EdgeItem *b) { return a->zValue() < b->zValue(); });
     }
-    _edgeItems.clear();
 
+    // old path items, indexed by the item of their first edge
+    QMap<EdgeItem*,PathItem*> oldPathItems;
     foreach (PathItem *pi, _pathItems) {
-        removeItem(pi);
-        delete pi;
+        EdgeItem *ei = pi->path()->edges().isEmpty() ?
+                    nullptr : _edgeItems.value(pi->path()->edges().first());
+        if (ei && !oldPathItems.contains(ei)) oldPathItems.insert(ei, pi);
+        else {
+            removeItem(pi);
+            delete pi;
+        }
     }
-    _pathItems.clear();
+
+    QMap<Node*,NodeItem*> nodeItems;
+    QMap<Edge*,EdgeItem*> edgeItems;
+    QMap<Path*,PathItem*> pathItems;
 
     foreach (Edge *e, graph()->edges()) {
-		//e->attachStyle();
-        //e->updateControls();
-        EdgeItem *ei = new EdgeItem(e);
-        _edgeItems.insert(e, ei);
-        addItem(ei);
+        EdgeItem *ei;
+        QList<EdgeItem*> &candidates = oldEdgeItems[edgeKey(e)];
+        if (!candidates.isEmpty()) {
+            ei = candidates.takeFirst();
+            ei->setEdge(e);
+        } else {
+            ei = new EdgeItem(e);
+            addItem(ei);
+        }
+        edgeItems.insert(e, ei);
 
         Path *p = e->path();
         if (p && p->edges().first() == e) {
-            PathItem *pi = new PathItem(p);
-            _pathItems.insert(p, pi);
-            addItem(pi);
+            PathItem *pi = oldPathItems.take(ei);
+            if (pi) {
+                pi->setPath(p);
+            } else {
+                pi = new PathItem(p);
+                addItem(pi);
+            }
+            pathItems.insert(p, pi);
         }
     }
 
     foreach (Node *n, graph()->nodes()) {
-        //n->attachStyle();
-        NodeItem *ni = new NodeItem(n);
-        _nodeItems.insert(n, ni);
-        addItem(ni);
+        NodeItem *ni = nullptr;
+        auto it = oldNodeItems.find(n->name());
+        if (it != oldNodeItems.end()) {
+            ni = it.value();
+            oldNodeItems.erase(it);
+            ni->setNode(n);
+        } else {
+            ni = new NodeItem(n);
+            addItem(ni);
+        }
+        nodeItems.insert(n, ni);
+    }
+
+    // anything left over has disappeared from the graph
+    foreach (PathItem *pi, oldPathItems) {
+        removeItem(pi);
+        delete pi;
+    }
+
+    foreach (const QList<EdgeItem*> &eis, oldEdgeItems) {
+        foreach (EdgeItem *ei, eis) {
+            removeItem(ei);
+            delete ei;
+        }
+    }
+
+    foreach (NodeItem *ni, oldNodeItems) {
+        removeItem(ni);
+        delete ni;
     }
 
+    _nodeItems = nodeItems;
+    _edgeItems = edgeItems;
+    _pathItems = pathItems;
+
     refreshZIndices();
     refreshSceneBounds();
 }
@@ -142,8 +282,9 @@ void TikzScene::extendSelectionUp()
         }
     }
 
-    foreach (NodeItem *ni, nodeItems().values()) {
-        if (ni->node()->point().y() >= m) ni->setSelected(true);
+    const QVector<Node*> &nodes = graph()->nodes();
+    for (int i = 0; i < nodes.size(); ++i) {
+        if (nodes[i]->point().y() >= m) setNodeSelected(nodes[i], true);
     }
 }
 
@@ -160,8 +301,9 @@ void TikzScene::extendSelectionDown()
         }
     }
 
-    foreach (NodeItem *ni, nodeItems().values()) {
-        if (ni->node()->point().y() <= m) ni->setSelected(true);
+    const QVector<Node*> &nodes = graph()->nodes();
+    for (int i = 0; i < nodes.size(); ++i) {
+        if (nodes[i]->point().y() <= m) setNodeSelected(nodes[i], true);
     }
 }
 
@@ -178,8 +320,9 @@ void TikzScene::extendSelectionLeft()
         }
     }
 
-    foreach (NodeItem *ni, nodeItems().values()) {
-        if (ni->node()->point().x() <= m) ni->setSelected(true);
+    const QVector<Node*> &nodes = graph()->nodes();
+    for (int i = 0; i < nodes.size(); ++i) {
+        if (nodes[i]->point().x() <= m) setNodeSelected(nodes[i], true);
     }
 }
 
@@ -196,14 +339,14 @@ void TikzScene::extendSelectionRight()
         }
     }
 
-    foreach (NodeItem *ni, nodeItems().values()) {
-        if (ni->node()->point().x() >= m) ni->setSelected(true);
+    const QVector<Node*> &nodes = graph()->nodes();
+    for (int i = 0; i < nodes.size(); ++i) {
+        if (nodes[i]->point().x() >= m) setNodeSelected(nodes[i], true);
     }
 }
 
 void TikzScene::mergeNodes()
 {
-    refreshZIndices();
     QSet<Node*> selNodes;
     QSet<Edge*> selEdges;
     getSelection(selNodes, selEdges);
@@ -216,7 +359,7 @@ void TikzScene::mergeNodes()
           static_cast<int>(n->point().x() * 1000.0),
           static_cast<int>(n->point().y() * 1000.0));
         if (!m.contains(fpPoint) ||
-            _nodeItems[m[fpPoint]]->zValue() < _nodeItems[n]->zValue())
+            _nodeOrder.key(m[fpPoint]) < _nodeOrder.key(n))
         {
             m.insert(fpPoint, n);
         }
@@ -268,30 +411,35 @@ void TikzScene::mergeNodes()
 
 void TikzScene::reorderSelection(bool toFront)
 {
-    QVector<Node*> nodeOrd, nodeOrd1;
-    QVector<Edge*> edgeOrd, edgeOrd1;
-    QSet<Node*> selNodes;
-    QSet<Edge*> selEdges;
-    getSelection(selNodes, selEdges);
-    foreach (Node *n, graph()->nodes()) {
-        if (selNodes.contains(n)) nodeOrd1 << n;
-        else nodeOrd << n;
+    // only the selected elements move, keeping their relative order
+    QVector<Node*> nodes;
+    QVector<int> oldNodeIndices, newNodeIndices;
+    const QVector<Node*> &allNodes = graph()->nodes();
+    for (int i = 0; i < allNodes.size(); ++i) {
+        if (_selectedNodes.contains(allNodes[i])) {
+            nodes << allNodes[i];
+            oldNodeIndices << i;
+        }
     }
 
-    foreach (Edge *e, graph()->edges()) {
-        if (selEdges.contains(e)) edgeOrd1 << e;
-        else edgeOrd << e;
+    QVector<Edge*> edges;
+    QVector<int> oldEdgeIndices, newEdgeIndices;
+    const QVector<Edge*> &allEdges = graph()->edges();
+    for (int i = 0; i < allEdges.size(); ++i) {
+        if (_selectedEdges.contains(allEdges[i])) {
+            edges << allEdges[i];
+            oldEdgeIndices << i;
+        }
     }
 
-    if (toFront) {
-        nodeOrd += nodeOrd1;
-        edgeOrd += edgeOrd1;
-    } else {
-        nodeOrd = nodeOrd1 + nodeOrd;
-        edgeOrd = edgeOrd1 + edgeOrd;
-    }
+    int nodeStart = toFront ? allNodes.size() - nodes.size() : 0;
+    for (int i = 0; i < nodes.size(); ++i) newNodeIndices << nodeStart + i;
+    int edgeStart = toFront ? allEdges.size() - edges.size() : 0;
+    for (int i = 0; i < edges.size(); ++i) newEdgeIndices << edgeStart + i;
 
-    ReorderCommand *cmd = new ReorderCommand(this, graph()->nodes(), nodeOrd, graph()->edges(), edgeOrd);
+    ReorderCommand *cmd = new ReorderCommand(this,
+        nodes, oldNodeIndices, newNodeIndices,
+        edges, oldEdgeIndices, newEdgeIndices);
     _tikzDocument->undoStack()->push(cmd);
 }
 
@@ -299,14 +447,11 @@ void TikzScene::reverseSelectedEdges()
 {
     // grab all the edges which are either selected themselves, or where
     // both their source and target nodes are selected
-    QSet<Edge*> es;
-    foreach (Edge *e, graph()->edges()) {
-        if ((_edgeItems[e] && _edgeItems[e]->isSelected()) ||
-            (_nodeItems[e->source()] && _nodeItems[e->target()] &&
-             _nodeItems[e->source()]->isSelected() &&
-             _nodeItems[e->target()]->isSelected()))
-        {
-            es << e;
+    QSet<Edge*> es = _selectedEdges;
+    foreach (Node *n, _selectedNodes) {
+        foreach (Edge *e, graph()->adjacentEdges(n)) {
+            if (_selectedNodes.contains(e->source()) && _selectedNodes.contains(e->target()))
+                es << e;
         }
     }
 
@@ -461,26 +606,107 @@ void TikzScene::splitPath()
 
 void TikzScene::refreshZIndices()
 {
-    qreal z = 0.0;
-    foreach (Edge *e, graph()->edges()) {
-        if (e->path() && e == e->path()->edges().first()) {
-            pathItems()[e->path()]->setZValue(z);
-            edgeItems()[e]->setZValue(z + 0.1);
-        } else {
-            edgeItems()[e]->setZValue(z);
-        }
-        z += 1.0;
+    _nodeOrder.assign(graph()->nodes());
+    _edgeOrder.assign(graph()->edges());
+
+    // n.b. in a virtualized scene, not every element has an item
+    foreach (EdgeItem *ei, _edgeItems) ei->setZValue(edgeZ(ei->edge()));
+    foreach (PathItem *pi, _pathItems) pi->setZValue(pathZ(pi->path()));
+    foreach (NodeItem *ni, _nodeItems) ni->setZValue(nodeZ(ni->node()));
+}
+
+void TikzScene::placeNodesInZOrder(const QVector<int> &indices)
+{
+    const QVector<Node*> &nodes = graph()->nodes();
+    if (!_nodeOrder.place(nodes, indices)) {
+        refreshZIndices();
+        return;
     }
 
-    foreach (Node *n, graph()->nodes()) {
-        nodeItems()[n]->setZValue(z);
-        z += 1.0;
+    foreach (int i, indices) {
+        if (NodeItem *ni = _nodeItems.value(nodes[i])) ni->setZValue(nodeZ(nodes[i]));
+    }
+}
+
+void TikzScene::placeEdgesInZOrder(const QVector<int> &indices)
+{
+    const QVector<Edge*> &edges = graph()->edges();
+    if (!_edgeOrder.place(edges, indices)) {
+        refreshZIndices();
+        return;
+    }
+
+    foreach (int i, indices) refreshZIndex(edges[i]);
+}
+
+void TikzScene::refreshZIndex(Edge *e)
+{
+    if (EdgeItem *ei = _edgeItems.value(e)) ei->setZValue(edgeZ(e));
+    if (e->path() && e == e->path()->edges().first()) {
+        if (PathItem *pi = _pathItems.value(e->path())) pi->setZValue(pathZ(e->path()));
+    }
+}
+
+void TikzScene::markDirty(const QRectF &rect)
+{
+    _dirtyRect = _dirtyRect.united(rect);
+    if (!_dirtyTimer->isActive()) _dirtyTimer->start();
+}
+
+void TikzScene::flushDirtyRegion()
+{
+    if (!_dirtyRect.isNull()) invalidate(_dirtyRect, QGraphicsScene::ItemLayer);
+    _dirtyRect = QRectF();
+}
+
+void TikzScene::requestRefresh()
+{
+    _refreshPending = true;
+    if (!_refreshTimer->isActive()) _refreshTimer->start();
+}
+
+void TikzScene::flushRefresh()
+{
+    if (!_refreshPending) return;
+    _refreshPending = false;
+    _refreshTimer->stop();
+
+    _tikzDocument->refreshTikz();
+    refreshSceneBounds();
+    flushDirtyRegion();
+}
+
+void TikzScene::markItemDirty(QGraphicsItem *item)
+{
+    if (TikzScene *sc = static_cast<TikzScene*>(item->scene())) {
+        sc->markDirty(item->sceneBoundingRect());
     }
 }
 
+void TikzScene::discardDirtyRegion()
+{
+    _dirtyRect = QRectF();
+}
+
+qreal TikzScene::nodeZ(Node *n) const
+{
+    return NODE_Z_OFFSET + _nodeOrder.key(n);
+}
+
+qreal TikzScene::edgeZ(Edge *e) const
+{
+    qreal z = _edgeOrder.key(e);
+    if (e->path() && e == e->path()->edges().first()) z += PATH_EDGE_Z_OFFSET;
+    return z;
+}
+
+qreal TikzScene::pathZ(Path *p) const
+{
+    return _edgeOrder.key(p->edges().first());
+}
+
 void TikzScene::mousePressEvent(QGraphicsSceneMouseEvent *event)
 {
-    QSettings settings("tikzit", "tikzit");
     if (!_enabled) return;
 
     // current mouse position, in scene coordinates
@@ -495,7 +721,7 @@ void TikzScene::mousePressEvent(QGraphicsSceneMouseEvent *event)
 
     if (event->button() == Qt::RightButton &&
         _tools->currentTool() == ToolPalette::SELECT &&
-        settings.value("smart-tool-enabled", true).toBool())
+        tikzit->preferences()->smartToolEnabled())
     {
         _smartTool = true;
         if (!items(_mouseDownPos).isEmpty() &&
@@ -510,8 +736,8 @@ void TikzScene::mousePressEvent(QGraphicsSceneMouseEvent *event)
     switch (_tools->currentTool()) {
     case ToolPalette::SELECT:
         // check if we grabbed a control point of an edge
-        foreach (QGraphicsItem *gi, selectedItems()) {
-            if (EdgeItem *ei = dynamic_cast<EdgeItem*>(gi)) {
+        foreach (Edge *e, _selectedEdges) {
+            if (EdgeItem *ei = _edgeItems.value(e)) {
                 qreal dx, dy;
 
                 dx = ei->cp1Item()->pos().x() - _mouseDownPos.x();
@@ -544,8 +770,14 @@ void TikzScene::mousePressEvent(QGraphicsSceneMouseEvent *event)
         } else {
             // since we are not dragging a control point, process the click normally
             //views()[0]->setDragMode(QGraphicsView::RubberBandDrag);
+            QList<QGraphicsItem*> pressed = items(_mouseDownPos);
+            bool clears = !(event->modifiers() & Qt::ControlModifier) &&
+                          (pressed.isEmpty() || !pressed[0]->isSelected());
             QGraphicsScene::mousePressEvent(event);
 
+            // the default handling only clears the selection of items
+            if (clears) deselectWithoutItems();
+
             if (items(_mouseDownPos).isEmpty()) {
                 _rubberBandItem->setRect(QRectF(_mouseDownPos,_mouseDownPos));
                 _rubberBandItem->setVisible(true);
@@ -562,16 +794,26 @@ void TikzScene::mousePressEvent(QGraphicsSceneMouseEvent *event)
 
             // save current node positions for undo support
             _oldNodePositions.clear();
-            foreach (QGraphicsItem *gi, selectedItems()) {
-                if (NodeItem *ni = dynamic_cast<NodeItem*>(gi)) {
-                    _oldNodePositions.insert(ni->node(), ni->node()->point());
-                }
+            foreach (Node *n, _selectedNodes) {
+                _oldNodePositions.insert(n, n->point());
             }
 
             QList<QGraphicsItem*> its = items(_mouseDownPos);
             if (!its.isEmpty()) {
                 if (dynamic_cast<NodeItem*>(its[0])) {
                     _draggingNodes = true;
+
+                    // capture the edges and paths that move along with the dragged nodes
+                    _dragShift = QPointF();
+                    _appliedDragShift = QPointF();
+                    _dragEdges.clear();
+                    _dragPaths.clear();
+                    foreach (Node *n, _oldNodePositions.keys()) {
+                        foreach (Edge *e, graph()->adjacentEdges(n)) {
+                            _dragEdges << e;
+                            if (e->path()) _dragPaths << e->path();
+                        }
+                    }
                 } else {
                     foreach (QGraphicsItem *gi, its) {
                         if (EdgeItem *ei = dynamic_cast<EdgeItem*>(gi)) {
@@ -693,7 +935,7 @@ void TikzScene::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
 
             _modifyEdgeItem->readPos();
             Path *p = _modifyEdgeItem->edge()->path();
-            if (p) pathItems()[p]->readPos();
+            if (p) pathItem(p)->readPos();
 
         } else if (_draggingNodes) { // nodes being dragged
             QGraphicsScene::mouseMoveEvent(event);
@@ -703,17 +945,10 @@ void TikzScene::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
             QPointF shift = mousePos - _mouseDownPos;
             shift = QPointF(round(shift.x()/GRID_SEP)*GRID_SEP, round(shift.y()/GRID_SEP)*GRID_SEP);
 
-            foreach (Node *n, _oldNodePositions.keys()) {
-                NodeItem *ni = _nodeItems[n];
-
-				// in (rare) cases, the graph can change while we are dragging
-				if (ni != nullptr) {
-					ni->setPos(toScreen(_oldNodePositions[n]) + shift);
-					ni->writePos();
-				}
-            }
-
-            refreshAdjacentEdges(_oldNodePositions.keys());
+            // mouse events can arrive much faster than the display refreshes, so just
+            // record the shift and apply it on the next frame
+            _dragShift = shift;
+            if (!_dragTimer->isActive()) _dragTimer->start();
         } else {
             // otherwise, process mouse move normally
             QGraphicsScene::mouseMoveEvent(event);
@@ -755,7 +990,6 @@ void TikzScene::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
 void TikzScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 {
     if (!_enabled) return;
-    QSettings settings("tikzit", "tikzit");
 
     // current mouse position, in scene coordinates
     QPointF mousePos = event->scenePos();
@@ -781,14 +1015,14 @@ void TikzScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
             QGraphicsScene::mouseReleaseEvent(event);
 
             if (_selectingEdge) {
-                bool sel = edgeItems()[_selectingEdge]->isSelected();
+                bool sel = _selectedEdges.contains(_selectingEdge);
                 Path *p = _selectingEdge->path();
                 if (p) {
                     foreach (Edge *e, p->edges()) {
                         if (e != _selectingEdge)
-                            edgeItems()[e]->setSelected(sel);
-                        nodeItems()[e->source()]->setSelected(sel);
-                        nodeItems()[e->target()]->setSelected(sel);
+                            setEdgeSelected(e, sel);
+                        setNodeSelected(e->source(), sel);
+                        setNodeSelected(e->target(), sel);
                     }
                 }
 //                else {
@@ -798,17 +1032,26 @@ void TikzScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
             }
 
             if (_rubberBandItem->isVisible()) {
-                QPainterPath sel;
-                sel.addRect(_rubberBandItem->rect());
-                foreach (QGraphicsItem *gi, items()) {
-                    if (NodeItem *ni = dynamic_cast<NodeItem*>(gi)) {
-                        if (sel.contains(toScreen(ni->node()->point()))) ni->setSelected(true);
-                    }
-                }
+                // n.b. this also selects nodes without an item in a virtualized scene
+                if (!_index.isValid()) _index.build(graph());
+                QRectF sel = rectFromScreen(_rubberBandItem->rect());
+                foreach (Node *n, _index.nodesIn(sel)) setNodeSelected(n, true);
                 //setSelectionArea(sel);
             }
 
-            _rubberBandItem->setVisible(false);
+            // clear artefacts from rubber band selection
+            if (_rubberBandItem->isVisible()) {
+                invalidate(_rubberBandItem->sceneBoundingRect(), QGraphicsScene::BackgroundLayer);
+                _rubberBandItem->setVisible(false);
+            }
+
+            if (_draggingNodes) {
+                // apply any pending drag before reading back node positions
+                if (_dragTimer->isActive()) {
+                    _dragTimer->stop();
+                    applyDrag();
+                }
+            }
 
             if (!_oldNodePositions.empty()) {
                 QPointF shift = mousePos - _mouseDownPos;
@@ -817,11 +1060,9 @@ void TikzScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
                 if (shift.x() != 0.0 || shift.y() != 0.0) {
                     QMap<Node*,QPointF> newNodePositions;
 
-                    foreach (QGraphicsItem *gi, selectedItems()) {
-                        if (NodeItem *ni = dynamic_cast<NodeItem*>(gi)) {
-                            ni->writePos();
-                            newNodePositions.insert(ni->node(), ni->node()->point());
-                        }
+                    foreach (Node *n, _selectedNodes) {
+                        if (NodeItem *ni = _nodeItems.value(n)) ni->writePos();
+                        newNodePositions.insert(n, n->point());
                     }
 
                     //qDebug() << _oldNodePositions;
@@ -832,6 +1073,12 @@ void TikzScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 
                 _oldNodePositions.clear();
             }
+
+            if (_draggingNodes) {
+                _dragEdges.clear();
+                _dragPaths.clear();
+                _draggingNodes = false;
+            }
         }
 
         break;
@@ -858,7 +1105,7 @@ void TikzScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
             Edge *e = new Edge(_edgeStartNodeItem->node(), _edgeEndNodeItem->node(), _tikzDocument);
 			e->setStyleName(_styles->activeEdgeStyleName());
 
-            bool selectEdge = settings.value("select-new-edges", false).toBool();
+            bool selectEdge = tikzit->preferences()->selectNewEdges();
             QSet<Node*> selNodes;
             QSet<Edge*> selEdges;
             if (selectEdge) getSelection(selNodes, selEdges);
@@ -879,9 +1126,6 @@ void TikzScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
     }
 
     _smartTool = false;
-
-    // clear artefacts from rubber band selection
-    invalidate(QRect(), QGraphicsScene::BackgroundLayer);
 }
 
 
@@ -908,7 +1152,7 @@ void TikzScene::keyReleaseEvent(QKeyEvent *event)
 
 
 
-    foreach (QGraphicsItem *it, selectedItems()) it->update();
+    updateSelectedItems();
 }
 
 void TikzScene::keyPressEvent(QKeyEvent *event)
@@ -949,12 +1193,10 @@ void TikzScene::keyPressEvent(QKeyEvent *event)
                 QMap<Node*,QPointF> newNodePositions;
                 QPointF pos;
 
-                foreach (QGraphicsItem *gi, selectedItems()) {
-                    if (NodeItem *ni = dynamic_cast<NodeItem*>(gi)) {
-                        pos = ni->node()->point();
-                        oldNodePositions.insert(ni->node(), pos);
-                        newNodePositions.insert(ni->node(), pos + delta);
-                    }
+                foreach (Node *n, _selectedNodes) {
+                    pos = n->point();
+                    oldNodePositions.insert(n, pos);
+                    newNodePositions.insert(n, pos + delta);
                 }
 
                 MoveCommand *cmd = new MoveCommand(this, oldNodePositions, newNodePositions);
@@ -1063,7 +1305,7 @@ void TikzScene::keyPressEvent(QKeyEvent *event)
         }
     }
 
-    foreach (QGraphicsItem *it, selectedItems()) it->update();
+    updateSelectedItems();
     if (!capture) QGraphicsScene::keyPressEvent(event);
 }
 
@@ -1113,6 +1355,16 @@ void TikzScene::setDrawNodeLabels(bool drawNodeLabels)
     _drawNodeLabels = drawNodeLabels;
 }
 
+bool TikzScene::fastRendering() const
+{
+    return _fastRendering;
+}
+
+void TikzScene::setFastRendering(bool fastRendering)
+{
+    _fastRendering = fastRendering;
+}
+
 bool TikzScene::highlightTails() const
 {
     return _highlightTails && getSelectedNodes().isEmpty();
@@ -1136,11 +1388,48 @@ void TikzScene::setEnabled(bool enabled)
 
 int TikzScene::lineNumberForSelection()
 {
-    foreach (QGraphicsItem *gi, selectedItems()) {
-        if (NodeItem *ni = dynamic_cast<NodeItem*>(gi)) return ni->node()->tikzLine();
-        if (EdgeItem *ei = dynamic_cast<EdgeItem*>(gi)) return ei->edge()->tikzLine();
+    // the selection is unordered, so go to the first line of it that is known,
+    // preferring nodes over edges
+    int line = -1;
+    foreach (Node *n, _selectedNodes) {
+        if (n->tikzLine() >= 0 && (line == -1 || n->tikzLine() < line)) line = n->tikzLine();
+    }
+    if (line != -1) return line;
+
+    foreach (Edge *e, _selectedEdges) {
+        if (e->tikzLine() >= 0 && (line == -1 || e->tikzLine() < line)) line = e->tikzLine();
+    }
+    return (line != -1) ? line : 0;
+}
+
+QVector<QPair<int,int>> TikzScene::sourceRangesForSelection() const
+{
+    const SourceMap &map = _tikzDocument->graph()->sourceMap();
+    QVector<QPair<int,int>> ranges;
+    foreach (Node *n, _selectedNodes) {
+        QPair<int,int> r = map.nodeRange(n);
+        if (r.first != -1) ranges << r;
     }
-    return 0;
+    foreach (Edge *e, _selectedEdges) {
+        QPair<int,int> r = map.edgeRange(e);
+        if (r.first != -1) ranges << r;
+    }
+    return ranges;
+}
+
+bool TikzScene::selectAtSourcePosition(int pos)
+{
+    const SourceMap &map = graph()->sourceMap();
+    Node *n = map.nodeAt(pos);
+    Edge *e = (n == nullptr) ? map.edgeAt(pos) : nullptr;
+    if (n == nullptr && e == nullptr) return false;
+
+    QSet<Node*> nodes;
+    QSet<Edge*> edges;
+    if (n != nullptr) nodes << n;
+    else edges << e;
+    setSelection(nodes, edges);
+    return true;
 }
 
 
@@ -1233,20 +1522,12 @@ void TikzScene::pasteFromClipboard()
 
 void TikzScene::selectAllNodes()
 {
-    foreach (NodeItem *ni, _nodeItems.values()) {
-        ni->setSelected(true);
-    }
+    foreach (Node *n, graph()->nodes()) setNodeSelected(n, true);
 }
 
 void TikzScene::deselectAll()
 {
-    foreach (NodeItem *ni, _nodeItems.values()) {
-        ni->setSelected(false);
-    }
-
-    foreach (EdgeItem *ei, _edgeItems.values()) {
-        ei->setSelected(false);
-    }
+    setSelection(QSet<Node*>(), QSet<Edge*>());
 }
 
 bool TikzScene::parseTikz(QString tikz)
@@ -1279,19 +1560,83 @@ void TikzScene::rotateNodes(bool clockwise)
 
 void TikzScene::getSelection(QSet<Node *> &selNodes, QSet<Edge *> &selEdges) const
 {
-    foreach (QGraphicsItem *gi, selectedItems()) {
-        if (NodeItem *ni = dynamic_cast<NodeItem*>(gi)) selNodes << ni->node();
-        if (EdgeItem *ei = dynamic_cast<EdgeItem*>(gi)) selEdges << ei->edge();
-    }
+    selNodes.unite(_selectedNodes);
+    selEdges.unite(_selectedEdges);
 }
 
 QSet<Node *> TikzScene::getSelectedNodes() const
 {
-    QSet<Node*> selNodes;
-    foreach (QGraphicsItem *gi, selectedItems()) {
-        if (NodeItem *ni = dynamic_cast<NodeItem*>(gi)) selNodes << ni->node();
+    return _selectedNodes;
+}
+
+const QSet<Node *> &TikzScene::selectedNodes() const
+{
+    return _selectedNodes;
+}
+
+const QSet<Edge *> &TikzScene::selectedEdges() const
+{
+    return _selectedEdges;
+}
+
+void TikzScene::nodeSelectionChanged(Node *n, bool selected)
+{
+    if (_recycling || selected == _selectedNodes.contains(n)) return;
+    if (selected) _selectedNodes.insert(n);
+    else _selectedNodes.remove(n);
+    if (!_selectionTimer->isActive()) _selectionTimer->start();
+}
+
+void TikzScene::edgeSelectionChanged(Edge *e, bool selected)
+{
+    if (_recycling || selected == _selectedEdges.contains(e)) return;
+    if (selected) _selectedEdges.insert(e);
+    else _selectedEdges.remove(e);
+    if (!_selectionTimer->isActive()) _selectionTimer->start();
+}
+
+void TikzScene::setNodeSelected(Node *n, bool selected)
+{
+    if (NodeItem *ni = _nodeItems.value(n)) ni->setSelected(selected);
+    else nodeSelectionChanged(n, selected);
+}
+
+void TikzScene::setEdgeSelected(Edge *e, bool selected)
+{
+    if (EdgeItem *ei = _edgeItems.value(e)) ei->setSelected(selected);
+    else edgeSelectionChanged(e, selected);
+}
+
+void TikzScene::setSelection(const QSet<Node *> &nodes, const QSet<Edge *> &edges)
+{
+    foreach (Node *n, _selectedNodes) {
+        if (!nodes.contains(n)) setNodeSelected(n, false);
+    }
+    foreach (Edge *e, _selectedEdges) {
+        if (!edges.contains(e)) setEdgeSelected(e, false);
+    }
+    foreach (Node *n, nodes) setNodeSelected(n, true);
+    foreach (Edge *e, edges) setEdgeSelected(e, true);
+}
+
+void TikzScene::updateSelectedItems()
+{
+    foreach (Node *n, _selectedNodes) {
+        if (NodeItem *ni = _nodeItems.value(n)) ni->update();
+    }
+    foreach (Edge *e, _selectedEdges) {
+        if (EdgeItem *ei = _edgeItems.value(e)) ei->update();
+    }
+}
+
+void TikzScene::deselectWithoutItems()
+{
+    foreach (Node *n, _selectedNodes) {
+        if (!_nodeItems.contains(n)) nodeSelectionChanged(n, false);
+    }
+    foreach (Edge *e, _selectedEdges) {
+        if (!_edgeItems.contains(e)) edgeSelectionChanged(e, false);
     }
-    return selNodes;
 }
 
 
@@ -1302,20 +1647,256 @@ TikzDocument *TikzScene::tikzDocument() const
 
 void TikzScene::setTikzDocument(TikzDocument *tikzDocument)
 {
+    flushRefresh();
+    if (_tikzDocument) disconnect(_tikzDocument->undoStack(), nullptr, this, nullptr);
     _tikzDocument = tikzDocument;
+    connect(_tikzDocument->undoStack(), SIGNAL(indexChanged(int)), this, SLOT(flushRefresh()));
+
+    // items from a different document never correspond to elements of the new graph
+    clearItems();
     graphReplaced();
 }
 
+void TikzScene::clearItems()
+{
+    foreach (Node *n, _nodeItems.keys()) dropNodeItem(n);
+    foreach (Edge *e, _edgeItems.keys()) dropEdgeItem(e);
+    foreach (Path *p, _pathItems.keys()) dropPathItem(p);
+}
+
+NodeItem *TikzScene::nodeItem(Node *n)
+{
+    NodeItem *ni = _nodeItems.value(n);
+    if (ni == nullptr) ni = materializeNode(n);
+    return ni;
+}
+
+EdgeItem *TikzScene::edgeItem(Edge *e)
+{
+    EdgeItem *ei = _edgeItems.value(e);
+    if (ei == nullptr) ei = materializeEdge(e);
+    return ei;
+}
+
+PathItem *TikzScene::pathItem(Path *p)
+{
+    PathItem *pi = _pathItems.value(p);
+    if (pi == nullptr) {
+        pi = new PathItem(p);
+        pi->setZValue(pathZ(p));
+        _pathItems.insert(p, pi);
+        addItem(pi);
+    }
+    return pi;
+}
+
+NodeItem *TikzScene::materializeNode(Node *n)
+{
+    NodeItem *ni = _nodeItems.value(n);
+    if (ni != nullptr) return ni;
+
+    if (_nodeItemPool.isEmpty()) {
+        ni = new NodeItem(n);
+    } else {
+        ni = _nodeItemPool.takeLast();
+        ni->setNode(n);
+    }
+
+    ni->setZValue(nodeZ(n));
+    _nodeItems.insert(n, ni);
+    addItem(ni);
+    if (_selectedNodes.contains(n)) ni->setSelected(true);
+    return ni;
+}
+
+EdgeItem *TikzScene::materializeEdge(Edge *e)
+{
+    EdgeItem *ei = _edgeItems.value(e);
+    if (ei != nullptr) return ei;
+
+    if (_edgeItemPool.isEmpty()) {
+        ei = new EdgeItem(e);
+    } else {
+        ei = _edgeItemPool.takeLast();
+        ei->setEdge(e);
+    }
+
+    ei->setZValue(edgeZ(e));
+    _edgeItems.insert(e, ei);
+    addItem(ei);
+    if (_selectedEdges.contains(e)) ei->setSelected(true);
+    return ei;
+}
+
+NodeItem *TikzScene::addNodeItem(Node *n)
+{
+    _index.updateNode(n);
+    return materializeNode(n);
+}
+
+EdgeItem *TikzScene::addEdgeItem(Edge *e)
+{
+    _index.updateEdge(e);
+    return materializeEdge(e);
+}
+
+void TikzScene::recycleNodeItem(Node *n)
+{
+    NodeItem *ni = _nodeItems.take(n);
+    if (ni == nullptr) return;
+
+    // the node stays selected, even though its item leaves the scene
+    _recycling = true;
+    removeItem(ni);
+    _recycling = false;
+
+    if (_virtualized && _nodeItemPool.size() < ITEM_POOL_SIZE) {
+        ni->setSelected(false);
+        _nodeItemPool << ni;
+    } else {
+        delete ni;
+    }
+}
+
+void TikzScene::recycleEdgeItem(Edge *e)
+{
+    EdgeItem *ei = _edgeItems.take(e);
+    if (ei == nullptr) return;
+    if (ei == _modifyEdgeItem) _modifyEdgeItem = nullptr;
+
+    _recycling = true;
+    removeItem(ei);
+    _recycling = false;
+
+    if (_virtualized && _edgeItemPool.size() < ITEM_POOL_SIZE) {
+        ei->setSelected(false);
+        _edgeItemPool << ei;
+    } else {
+        delete ei;
+    }
+}
+
+void TikzScene::dropNodeItem(Node *n)
+{
+    nodeSelectionChanged(n, false);
+    _index.removeNode(n);
+    recycleNodeItem(n);
+}
+
+void TikzScene::dropEdgeItem(Edge *e)
+{
+    edgeSelectionChanged(e, false);
+    _index.removeEdge(e);
+    recycleEdgeItem(e);
+}
+
+void TikzScene::dropPathItem(Path *p)
+{
+    PathItem *pi = _pathItems.take(p);
+    if (pi == nullptr) return;
+    removeItem(pi);
+    delete pi;
+}
+
+bool TikzScene::virtualized() const
+{
+    return _virtualized;
+}
+
+void TikzScene::setViewRect(QRectF rect)
+{
+    _viewRect = rect;
+    if (_virtualized) _materializeTimer->start();
+}
+
+void TikzScene::refreshVisible()
+{
+    if (_virtualized) _materializeTimer->start();
+}
+
+void TikzScene::refreshEdge(Edge *e)
+{
+    _index.updateEdge(e);
+    if (EdgeItem *ei = _edgeItems.value(e)) ei->readPos();
+    if (e->path()) {
+        if (PathItem *pi = _pathItems.value(e->path())) pi->readPos();
+    }
+}
+
+void TikzScene::materializeVisible()
+{
+    if (!_virtualized) return;
+    if (!_index.isValid()) _index.build(graph());
+
+    // keep items for a margin of half a view around the visible region, so small
+    // pans don't need to create anything
+    qreal mx = 0.5 * _viewRect.width();
+    qreal my = 0.5 * _viewRect.height();
+    QRectF region = rectFromScreen(_viewRect.adjusted(-mx, -my, mx, my));
+
+    QVector<Node*> visibleNodes = _index.nodesIn(region);
+    QVector<Edge*> visibleEdges = _index.edgesIn(region);
+
+    // when zoomed far out, first drop the margin, and then only give items to some
+    // of the elements, so the number of items stays bounded
+    if (visibleNodes.size() + visibleEdges.size() > MATERIALIZE_MAX_ITEMS) {
+        region = rectFromScreen(_viewRect);
+        visibleNodes = _index.nodesIn(region);
+        visibleEdges = _index.edgesIn(region);
+    }
+
+    int maxNodes = qMax(MATERIALIZE_MAX_ITEMS / 2, MATERIALIZE_MAX_ITEMS - visibleEdges.size());
+    if (visibleNodes.size() > maxNodes) visibleNodes.resize(maxNodes);
+    int maxEdges = MATERIALIZE_MAX_ITEMS - visibleNodes.size();
+    if (visibleEdges.size() > maxEdges) visibleEdges.resize(maxEdges);
+
+    QSet<Node*> keepNodes;
+    QSet<Edge*> keepEdges;
+    QSet<Path*> keepPaths;
+    foreach (Node *n, visibleNodes) keepNodes << n;
+    foreach (Edge *e, visibleEdges) {
+        keepEdges << e;
+        if (e->path()) keepPaths << e->path();
+    }
+
+    // recycle items that are out of range, except for those taking part in the
+    // current mouse interaction. Selected elements stay selected without an item.
+    foreach (Path *p, _pathItems.keys()) {
+        if (!keepPaths.contains(p)) dropPathItem(p);
+    }
+
+    foreach (Edge *e, _edgeItems.keys()) {
+        if (!keepEdges.contains(e) && _edgeItems.value(e) != _modifyEdgeItem)
+            recycleEdgeItem(e);
+    }
+
+    foreach (Node *n, _nodeItems.keys()) {
+        NodeItem *ni = _nodeItems.value(n);
+        if (!keepNodes.contains(n) && ni != _edgeStartNodeItem && ni != _edgeEndNodeItem &&
+            !(_draggingNodes && _oldNodePositions.contains(n)))
+            recycleNodeItem(n);
+    }
+
+    foreach (Edge *e, visibleEdges) materializeEdge(e);
+    foreach (Node *n, visibleNodes) materializeNode(n);
+    foreach (Path *p, keepPaths) pathItem(p);
+}
+
 void TikzScene::reloadStyles()
 {
     _styles->reloadStyles();
+
+    // attach styles to the whole graph, since a virtualized scene only has items
+    // for some of its elements
+    foreach (Edge *e, graph()->edges()) e->attachStyle();
+    foreach (Node *n, graph()->nodes()) n->attachStyle();
+
 	foreach(EdgeItem *ei, _edgeItems) {
-		ei->edge()->attachStyle();
 		ei->readPos(); // trigger a repaint
 	}
 
     foreach (NodeItem *ni, _nodeItems) {
-        ni->node()->attachStyle();
+        ni->updateBounds();
         ni->readPos(); // trigger a repaint
     }
 }
@@ -1324,14 +1905,14 @@ void TikzScene::refreshSceneBounds() {
     qreal maxX = 30.0, maxY = 30.0;
     qreal increment = 20.0;
 
-    foreach (Node *n, graph()->nodes()) {
-        while (n->point().x() - increment < -maxX || n->point().x() + increment > maxX) {
-            maxX += increment;
-        }
-
-        while (n->point().y() - increment < -maxY || n->point().y() + increment > maxY) {
-            maxY += increment;
-        }
+    // grow the bounds in steps of "increment", until there is a margin of at least
+    // "increment" around every node
+    QRectF nb = graph()->nodeBounds();
+    if (!graph()->nodes().isEmpty()) {
+        qreal x = qMax(-nb.left(), nb.right()) + increment;
+        qreal y = qMax(-nb.top(), nb.bottom()) + increment;
+        if (x > maxX) maxX += ceil((x - maxX) / increment) * increment;
+        if (y > maxY) maxY += ceil((y - maxY) / increment) * increment;
     }
 
     QRectF rect(-GLOBAL_SCALEF * maxX, -GLOBAL_SCALEF * maxY, 2.0 * GLOBAL_SCALEF * maxX, 2.0 * GLOBAL_SCALEF * maxY);
@@ -1362,28 +1943,59 @@ void TikzScene::refreshSceneBounds() {
 //     //setBounds(graphB);
 // }
 
+void TikzScene::applyDrag()
+{
+    if (!_draggingNodes || _dragShift == _appliedDragShift) return;
+    _appliedDragShift = _dragShift;
+
+    foreach (Node *n, _oldNodePositions.keys()) {
+        // in (rare) cases, the graph can change while we are dragging, which deselects
+        // the nodes that are gone
+        if (!_selectedNodes.contains(n)) continue;
+
+        // selected nodes of a virtualized scene need not have an item
+        QPointF pos = toScreen(_oldNodePositions[n]) + _dragShift;
+        if (NodeItem *ni = _nodeItems.value(n)) {
+            ni->setPos(pos);
+            ni->writePos();
+        } else {
+            n->setPoint(fromScreen(pos));
+        }
+    }
+
+    foreach (Edge *e, _dragEdges) {
+        e->updateControls();
+        if (EdgeItem *ei = _edgeItems.value(e)) ei->readPos();
+    }
+
+    foreach (Path *p, _dragPaths) {
+        if (PathItem *pi = _pathItems.value(p)) pi->readPos();
+    }
+}
+
 void TikzScene::refreshAdjacentEdges(QList<Node*> nodes)
 {
     if (nodes.empty()) return;
 
+    // collect each incident edge and path once, as edges may join two of the given nodes
+    QSet<Edge*> edges;
+    foreach (Node *n, nodes) {
+        foreach (Edge *e, graph()->adjacentEdges(n)) edges << e;
+    }
+
+    foreach (Node *n, nodes) _index.updateNode(n);
+
+    // edges without items (in a virtualized scene) still need their control points updated
     QSet<Path*> paths;
-    foreach (Edge *e, _edgeItems.keys()) {
-		EdgeItem *ei = _edgeItems[e];
-
-		// the list "nodes" can be out of date, e.g. if the graph changes while dragging
-		if (ei != nullptr) {
-			if (nodes.contains(ei->edge()->source()) || nodes.contains(ei->edge()->target())) {
-				ei->edge()->updateControls();
-				ei->readPos();
-			}
-		}
-
-        // only update paths once
-        Path *p = ei->edge()->path();
-        if (p && !paths.contains(p)) {
-            pathItems()[p]->readPos();
-            paths << p;
-        }
+    foreach (Edge *e, edges) {
+        e->updateControls();
+        _index.updateEdge(e);
+        if (EdgeItem *ei = _edgeItems.value(e)) ei->readPos();
+        if (e->path()) paths << e->path();
+    }
+
+    foreach (Path *p, paths) {
+        if (PathItem *pi = _pathItems.value(p)) pi->readPos();
     }
 }
 
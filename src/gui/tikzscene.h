@@ -31,6 +31,8 @@
 #include "tikzdocument.h"
 #include "toolpalette.h"
 #include "stylepalette.h"
+#include "graphindex.h"
+#include "zorder.h"
 
 #include <QWidget>
 #include <QGraphicsScene>
@@ -39,6 +41,7 @@
 #include <QVector>
 #include <QGraphicsEllipseItem>
 #include <QGraphicsSceneMouseEvent>
+#include <QTimer>
 
 class TikzScene : public QGraphicsScene
 {
@@ -51,6 +54,92 @@ public:
     QMap<Edge*,EdgeItem*> &edgeItems();
     QMap<Path*,PathItem*> &pathItems();
     void refreshAdjacentEdges(QList<Node*> nodes);
+
+    /*!
+     * \brief nodeItem returns the item for the given node. If the scene is virtualized
+     * and the node does not currently have an item, one is created.
+     */
+    NodeItem *nodeItem(Node *n);
+    EdgeItem *edgeItem(Edge *e);
+    PathItem *pathItem(Path *p);
+
+    /*!
+     * \brief addNodeItem creates an item for a node that has just been added to the
+     * graph, and adds the node to the spatial index.
+     */
+    NodeItem *addNodeItem(Node *n);
+    EdgeItem *addEdgeItem(Edge *e);
+
+    /*!
+     * \brief dropNodeItem is called when a node leaves the graph. It deselects the
+     * node, removes it from the spatial index and removes its item, if there is one.
+     */
+    void dropNodeItem(Node *n);
+    void dropEdgeItem(Edge *e);
+    void dropPathItem(Path *p);
+
+    /*!
+     * \brief refreshEdge re-reads the item of an edge, and of its path, and updates
+     * the spatial index after the edge's control points have changed.
+     */
+    void refreshEdge(Edge *e);
+
+    /*!
+     * \brief virtualized is true for large graphs, where only elements near the
+     * visible region of the view have graphics items.
+     */
+    bool virtualized() const;
+
+    /*!
+     * \brief setViewRect tells the scene which region (in scene coordinates) is
+     * currently visible. For virtualized scenes, this schedules items to be created
+     * or recycled.
+     */
+    void setViewRect(QRectF rect);
+
+    /*!
+     * \brief refreshVisible should be called whenever the graph changes. For
+     * virtualized scenes, this schedules items to be created or recycled.
+     */
+    void refreshVisible();
+
+    /*!
+     * \brief placeNodesInZOrder updates the z-values of the nodes at the given
+     * (ascending) positions of Graph::nodes(), after they have been inserted or moved
+     * there. Other items keep their z-values.
+     */
+    void placeNodesInZOrder(const QVector<int> &indices);
+    void placeEdgesInZOrder(const QVector<int> &indices);
+
+    /*!
+     * \brief refreshZIndex updates the z-value of a single edge, and of its path if it
+     * is the first edge of one. Call this when an edge is added to or removed from a path.
+     */
+    void refreshZIndex(Edge *e);
+
+    /*!
+     * \brief markDirty records a region (in scene coordinates) whose contents have
+     * changed. Items report their bounds here before and after each change, so undo
+     * commands can repaint just that region with flushDirtyRegion(), rather than the
+     * whole scene. Regions not flushed by the time control returns to the event loop
+     * are discarded, as Qt has already repainted the items involved.
+     */
+    void markDirty(const QRectF &rect);
+    void flushDirtyRegion();
+
+    /*!
+     * \brief requestRefresh marks the tikz source, the scene bounds and the dirty region
+     * as out of date. Rather than refreshing after every command, this is done once,
+     * when the current undo stack operation finishes. For a macro, or undoing one,
+     * that is after the last of its commands.
+     */
+    void requestRefresh();
+
+    /*!
+     * \brief markItemDirty reports the current bounds of the given item to its scene,
+     * if it is in one.
+     */
+    static void markItemDirty(QGraphicsItem *item);
 //    void setBounds(QRectF bounds);
 
     TikzDocument *tikzDocument() const;
@@ -72,6 +161,19 @@ public:
     void setEnabled(bool enabled);
     int lineNumberForSelection();
 
+    /*!
+     * \brief sourceRangesForSelection returns the character ranges of the selected
+     * nodes and edges in the code most recently produced by Graph::tikz().
+     */
+    QVector<QPair<int,int>> sourceRangesForSelection() const;
+
+    /*!
+     * \brief selectAtSourcePosition selects the node or edge whose code contains the
+     * given position, replacing the current selection.
+     * \return false if there is no element at that position
+     */
+    bool selectAtSourcePosition(int pos);
+
     void extendSelectionUp();
     void extendSelectionDown();
     void extendSelectionLeft();
@@ -89,6 +191,34 @@ public:
     void getSelection(QSet<Node*> &selNodes, QSet<Edge*> &selEdges) const;
     QSet<Node*> getSelectedNodes() const;
 
+    /*!
+     * \brief selectedNodes returns the selected nodes. In a virtualized scene, these
+     * need not have items. This is kept up to date by the items themselves and by
+     * setNodeSelected(), so it is cheap to call.
+     */
+    const QSet<Node*> &selectedNodes() const;
+    const QSet<Edge*> &selectedEdges() const;
+
+    /*!
+     * \brief setNodeSelected selects or deselects a node, through its item if it has
+     * one. Nodes without an item are not materialized.
+     */
+    void setNodeSelected(Node *n, bool selected);
+    void setEdgeSelected(Edge *e, bool selected);
+
+    /*!
+     * \brief setSelection replaces the current selection with the given elements.
+     */
+    void setSelection(const QSet<Node*> &nodes, const QSet<Edge*> &edges);
+
+    /*!
+     * \brief nodeSelectionChanged is called by a NodeItem when it is selected or
+     * deselected, or when it leaves the scene while selected. Items that are only
+     * recycled by virtualization do not change the selection.
+     */
+    void nodeSelectionChanged(Node *n, bool selected);
+    void edgeSelectionChanged(Edge *e, bool selected);
+
     void refreshSceneBounds();
 
     bool highlightHeads() const;
@@ -97,9 +227,29 @@ public:
     bool drawNodeLabels() const;
     void setDrawNodeLabels(bool drawNodeLabels);
 
+    /*!
+     * \brief fastRendering is set by the view while the user is dragging, panning or
+     * zooming. Items are then drawn without antialiasing and without label text.
+     */
+    bool fastRendering() const;
+    void setFastRendering(bool fastRendering);
+
+signals:
+    /*!
+     * \brief selectedElementsChanged is emitted once the selection settles, i.e. once
+     * for a whole batch of changes such as select-all.
+     */
+    void selectedElementsChanged();
+
 public slots:
     void graphReplaced();
     void refreshZIndices();
+    void materializeVisible();
+    void applyDrag();
+    void flushRefresh();
+
+private slots:
+    void discardDirtyRegion();
 
 protected:
     void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
@@ -109,6 +259,17 @@ protected:
     void keyPressEvent(QKeyEvent *event) override;
     void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override;
 private:
+    void clearItems();
+    NodeItem *materializeNode(Node *n);
+    EdgeItem *materializeEdge(Edge *e);
+    void recycleNodeItem(Node *n);
+    void recycleEdgeItem(Edge *e);
+    void deselectWithoutItems();
+    void updateSelectedItems();
+    qreal nodeZ(Node *n) const;
+    qreal edgeZ(Edge *e) const;
+    qreal pathZ(Path *p) const;
+
     TikzDocument *_tikzDocument;
     ToolPalette *_tools;
     StylePalette *_styles;
@@ -125,8 +286,26 @@ private:
     QPointF _mouseDownPos;
     bool _draggingNodes;
     bool _drawNodeLabels;
+    bool _fastRendering;
 
     QMap<Node*,QPointF> _oldNodePositions;
+
+    QSet<Node*> _selectedNodes;
+    QSet<Edge*> _selectedEdges;
+    QTimer *_selectionTimer;
+
+    QRectF _dirtyRect;
+    QTimer *_dirtyTimer;
+
+    bool _refreshPending;
+    QTimer *_refreshTimer;
+
+    // pending node drag, applied at most once per frame by _dragTimer
+    QTimer *_dragTimer;
+    QPointF _dragShift;
+    QPointF _appliedDragShift;
+    QSet<Edge*> _dragEdges;
+    QSet<Path*> _dragPaths;
     qreal _oldWeight;
     int _oldBend;
     int _oldInAngle;
@@ -138,6 +317,18 @@ private:
     bool _smartTool;
 
     bool _ctrlWasPressed;
+
+    bool _virtualized;
+    GraphIndex _index;
+    QRectF _viewRect;
+    QTimer *_materializeTimer;
+    QVector<NodeItem*> _nodeItemPool;
+    QVector<EdgeItem*> _edgeItemPool;
+    bool _recycling;
+
+    // ordering keys, used as z-values
+    ZOrder<Node> _nodeOrder;
+    ZOrder<Edge> _edgeOrder;
 };
 
 #endif // TIKZSCENE_H
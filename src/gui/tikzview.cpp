@@ -21,7 +21,19 @@
 
 #include <QDebug>
 #include <QScrollBar>
-#include <QSettings>
+#include <QVector>
+#include <QLineF>
+#include <QPaintEvent>
+#include <cmath>
+
+// how long repainted regions stay highlighted, in milliseconds
+#define REPAINT_FLASH_DURATION 150
+
+// how long the view must be left alone before it is drawn at full quality again
+#define INTERACTION_IDLE_DELAY 200
+
+// height of each strip of the view that is repainted at full quality, in pixels
+#define QUALITY_STRIP_HEIGHT 64
 
 TikzView::TikzView(QWidget *parent) : QGraphicsView(parent)
 {
@@ -33,110 +45,221 @@ TikzView::TikzView(QWidget *parent) : QGraphicsView(parent)
 
     _scale = 2.5f;
     scale(2.5, 2.5);
+
+    refreshGridColors();
+    connect(tikzit->preferences(), SIGNAL(gridColorsChanged()), this, SLOT(refreshGridColors()));
+
+    _showRepaints = false;
+    _clearingFlash = false;
+    _flashTimer = new QTimer(this);
+    _flashTimer->setSingleShot(true);
+    _flashTimer->setInterval(REPAINT_FLASH_DURATION);
+    connect(_flashTimer, SIGNAL(timeout()), this, SLOT(clearRepaintFlash()));
+
+    _interactionTimer = new QTimer(this);
+    _interactionTimer->setSingleShot(true);
+    _interactionTimer->setInterval(INTERACTION_IDLE_DELAY);
+    connect(_interactionTimer, SIGNAL(timeout()), this, SLOT(endInteraction()));
+
+    _qualityTimer = new QTimer(this);
+    _qualityTimer->setInterval(0);
+    connect(_qualityTimer, SIGNAL(timeout()), this, SLOT(repaintNextStrip()));
+}
+
+void TikzView::setShowRepaints(bool showRepaints)
+{
+    _showRepaints = showRepaints;
+    if (!showRepaints) clearRepaintFlash();
+}
+
+bool TikzView::showRepaints() const
+{
+    return _showRepaints;
+}
+
+void TikzView::noteInteraction()
+{
+    TikzScene *sc = dynamic_cast<TikzScene*>(scene());
+    if (!sc) return;
+
+    _qualityTimer->stop();
+    _qualityStrips.clear();
+    sc->setFastRendering(true);
+    _interactionTimer->start();
+}
+
+void TikzView::endInteraction()
+{
+    if (TikzScene *sc = dynamic_cast<TikzScene*>(scene())) sc->setFastRendering(false);
+
+    // queue up the parts of the view that were drawn quickly, in horizontal strips,
+    // so the full-quality repaint never blocks for long
+    QRect bounds = _fastRegion.boundingRect() & viewport()->rect();
+    for (int y = bounds.top(); y <= bounds.bottom(); y += QUALITY_STRIP_HEIGHT) {
+        QRect strip(bounds.left(), y, bounds.width(), QUALITY_STRIP_HEIGHT);
+        if (_fastRegion.intersects(strip)) _qualityStrips << strip;
+    }
+    _fastRegion = QRegion();
+    if (!_qualityStrips.isEmpty()) _qualityTimer->start();
+}
+
+void TikzView::repaintNextStrip()
+{
+    if (_qualityStrips.isEmpty()) {
+        _qualityTimer->stop();
+        return;
+    }
+
+    viewport()->repaint(_qualityStrips.takeFirst());
 }
 
 void TikzView::zoomIn()
 {
+    noteInteraction();
     _scale *= 1.6f;
     scale(1.6,1.6);
+    updateViewRect();
 }
 
 void TikzView::zoomOut()
 {
+    noteInteraction();
     _scale *= 0.625f;
     scale(0.625,0.625);
+    updateViewRect();
 }
 
 void TikzView::setScene(QGraphicsScene *scene)
 {
     QGraphicsView::setScene(scene);
     centerOn(QPointF(0.0,0.0));
+    updateViewRect();
 }
 
-void TikzView::drawBackground(QPainter *painter, const QRectF &rect)
+void TikzView::scrollContentsBy(int dx, int dy)
 {
-    QSettings settings("tikzit", "tikzit");
-    QGraphicsView::drawBackground(painter, rect);
-    // draw a gray background if disabled
-    TikzScene *sc = static_cast<TikzScene*>(scene());
-    if (!sc->enabled()) painter->fillRect(rect, QBrush(QColor(240,240,240)));
-
-    // draw the grid
+    noteInteraction();
+    // whatever was drawn quickly moves along with the contents
+    _fastRegion.translate(dx, dy);
+    QGraphicsView::scrollContentsBy(dx, dy);
+    updateViewRect();
+}
 
-    QPen pen1;
-    //pen1.setWidthF(0.5);
-    pen1.setCosmetic(true);
-    pen1.setColor(settings.value("grid-color-minor", QColor(250,250,255)).value<QColor>());
+void TikzView::mouseMoveEvent(QMouseEvent *event)
+{
+    // dragging nodes, edges or the rubber band
+    if (event->buttons() != Qt::NoButton) noteInteraction();
+    QGraphicsView::mouseMoveEvent(event);
+}
 
-    QPen pen2 = pen1;
-    pen2.setColor(settings.value("grid-color-major", QColor(240,240,250)).value<QColor>());
+void TikzView::resizeEvent(QResizeEvent *event)
+{
+    QGraphicsView::resizeEvent(event);
+    updateViewRect();
+}
 
-    QPen pen3 = pen1;
-    pen3.setColor(settings.value("grid-color-axes", QColor(220,220,240)).value<QColor>());
+void TikzView::paintEvent(QPaintEvent *event)
+{
+    QGraphicsView::paintEvent(event);
 
-    painter->setPen(pen1);
+    TikzScene *sc = dynamic_cast<TikzScene*>(scene());
+    if (sc && sc->fastRendering()) _fastRegion += event->region();
+    else _fastRegion -= event->region();
 
-    if (_scale > 0.2f) {
-        for (int x = -GRID_SEP; x > rect.left(); x -= GRID_SEP) {
-            if (x % (GRID_SEP * GRID_N) != 0) {
-                qreal xf = (qreal)x;
-                painter->drawLine(xf, rect.top(), xf, rect.bottom());
-            }
-        }
+    // the repaint that removes a flash is not itself highlighted
+    if (_showRepaints && !_clearingFlash) {
+        QPainter painter(viewport());
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(QColor(255, 0, 255, 60));
+        for (const QRect &r : event->region()) painter.drawRect(r);
 
-        for (int x = GRID_SEP; x < rect.right(); x += GRID_SEP) {
-            if (x % (GRID_SEP * GRID_N) != 0) {
-                qreal xf = (qreal)x;
-                painter->drawLine(xf, rect.top(), xf, rect.bottom());
-            }
-        }
+        _flashRegion += event->region();
+        _flashTimer->start();
+    }
+}
 
-        for (int y = -GRID_SEP; y > rect.top(); y -= GRID_SEP) {
-            if (y % (GRID_SEP * GRID_N) != 0) {
-                qreal yf = (qreal)y;
-                painter->drawLine(rect.left(), yf, rect.right(), yf);
-            }
-        }
+void TikzView::clearRepaintFlash()
+{
+    if (_flashRegion.isEmpty()) return;
+    _clearingFlash = true;
+    viewport()->repaint(_flashRegion);
+    _clearingFlash = false;
+    _flashRegion = QRegion();
+}
 
-        for (int y = GRID_SEP; y < rect.bottom(); y += GRID_SEP) {
-            if (y % (GRID_SEP * GRID_N) != 0) {
-                qreal yf = (qreal)y;
-                painter->drawLine(rect.left(), yf, rect.right(), yf);
-            }
-        }
+void TikzView::updateViewRect()
+{
+    // let the scene know what is visible, so it can materialize items for large graphs
+    if (TikzScene *sc = dynamic_cast<TikzScene*>(scene())) {
+        sc->setViewRect(mapToScene(viewport()->rect()).boundingRect());
     }
+}
 
-    painter->setPen(pen2);
+void TikzView::refreshGridColors()
+{
+    _gridColorMinor = tikzit->preferences()->gridColorMinor();
+    _gridColorMajor = tikzit->preferences()->gridColorMajor();
+    _gridColorAxes = tikzit->preferences()->gridColorAxes();
+    resetCachedContent();
+    viewport()->update();
+}
 
-    for (int x = -GRID_SEP*GRID_N; x > rect.left(); x -= GRID_SEP*GRID_N) {
-        qreal xf = (qreal)x;
-        painter->drawLine(xf, rect.top(), xf, rect.bottom());
-    }
+void TikzView::drawBackground(QPainter *painter, const QRectF &rect)
+{
+    QGraphicsView::drawBackground(painter, rect);
+    // draw a gray background if disabled
+    TikzScene *sc = static_cast<TikzScene*>(scene());
+    if (!sc->enabled()) painter->fillRect(rect, QBrush(QColor(240,240,240)));
+
+    // draw the grid. Lines are collected first, so each layer of the grid is
+    // drawn with a single call. The minor grid is skipped entirely once its
+    // lines would be too close together on screen to be useful.
+
+    bool drawMinor = _scale * GRID_SEPF >= GRID_MIN_PIXELS;
+    int step = drawMinor ? GRID_SEP : GRID_SEP * GRID_N;
+    QVector<QLineF> minorLines;
+    QVector<QLineF> majorLines;
 
-    for (int x = GRID_SEP*GRID_N; x < rect.right(); x += GRID_SEP*GRID_N) {
+    int x0 = static_cast<int>(std::ceil(rect.left() / step)) * step;
+    for (int x = x0; x < rect.right(); x += step) {
+        if (x == 0) continue;
         qreal xf = (qreal)x;
-        painter->drawLine(xf, rect.top(), xf, rect.bottom());
+        if (x % (GRID_SEP * GRID_N) == 0) majorLines << QLineF(xf, rect.top(), xf, rect.bottom());
+        else minorLines << QLineF(xf, rect.top(), xf, rect.bottom());
     }
 
-    for (int y = -GRID_SEP*GRID_N; y > rect.top(); y -= GRID_SEP*GRID_N) {
+    int y0 = static_cast<int>(std::ceil(rect.top() / step)) * step;
+    for (int y = y0; y < rect.bottom(); y += step) {
+        if (y == 0) continue;
         qreal yf = (qreal)y;
-        painter->drawLine(rect.left(), yf, rect.right(), yf);
+        if (y % (GRID_SEP * GRID_N) == 0) majorLines << QLineF(rect.left(), yf, rect.right(), yf);
+        else minorLines << QLineF(rect.left(), yf, rect.right(), yf);
     }
 
-    for (int y = GRID_SEP*GRID_N; y < rect.bottom(); y += GRID_SEP*GRID_N) {
-        qreal yf = (qreal)y;
-        painter->drawLine(rect.left(), yf, rect.right(), yf);
+    QPen pen;
+    pen.setCosmetic(true);
+
+    if (!minorLines.isEmpty()) {
+        pen.setColor(_gridColorMinor);
+        painter->setPen(pen);
+        painter->drawLines(minorLines);
+    }
+
+    if (!majorLines.isEmpty()) {
+        pen.setColor(_gridColorMajor);
+        painter->setPen(pen);
+        painter->drawLines(majorLines);
     }
 
-    painter->setPen(pen3);
-    painter->drawLine(rect.left(), 0, rect.right(), 0);
-    painter->drawLine(0, rect.top(), 0, rect.bottom());
+    pen.setColor(_gridColorAxes);
+    painter->setPen(pen);
+    painter->drawLine(QLineF(rect.left(), 0, rect.right(), 0));
+    painter->drawLine(QLineF(0, rect.top(), 0, rect.bottom()));
 }
 
 void TikzView::wheelEvent(QWheelEvent *event)
 {
-    QSettings settings("tikzit", "tikzit");
-    bool shiftScroll = settings.value("shift-to-scroll", false).toBool();
+    bool shiftScroll = tikzit->preferences()->shiftToScroll();
     if ((!shiftScroll && event->modifiers() == Qt::NoModifier) ||
         (shiftScroll && (event->modifiers() == Qt::ShiftModifier)))
     {
@@ -32,6 +32,10 @@
 #include <QStyleOptionGraphicsItem>
 #include <QRectF>
 #include <QMouseEvent>
+#include <QColor>
+#include <QRegion>
+#include <QTimer>
+#include <QVector>
 
 class TikzView : public QGraphicsView
 {
@@ -39,15 +43,53 @@ class TikzView : public QGraphicsView
 public:
     explicit TikzView(QWidget *parent = 0);
 
+    /*!
+     * \brief setShowRepaints turns on a debugging overlay, which briefly highlights
+     * every region of the view as it is repainted.
+     */
+    void setShowRepaints(bool showRepaints);
+    bool showRepaints() const;
+
+    /*!
+     * \brief noteInteraction switches the scene to fast rendering until the user has
+     * been idle for a moment, after which the parts of the view that were drawn in
+     * the meantime are repainted at full quality, one strip at a time.
+     */
+    void noteInteraction();
+
 public slots:
     void zoomIn();
     void zoomOut();
     void setScene(QGraphicsScene *scene);
+    void refreshGridColors();
 protected:
     void drawBackground(QPainter *painter, const QRectF &rect) override;
     void wheelEvent(QWheelEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+private slots:
+    void clearRepaintFlash();
+    void endInteraction();
+    void repaintNextStrip();
 private:
+    void updateViewRect();
+
     float _scale;
+    QColor _gridColorMinor;
+    QColor _gridColorMajor;
+    QColor _gridColorAxes;
+
+    bool _showRepaints;
+    bool _clearingFlash;
+    QRegion _flashRegion;
+    QTimer *_flashTimer;
+
+    QRegion _fastRegion;
+    QVector<QRect> _qualityStrips;
+    QTimer *_interactionTimer;
+    QTimer *_qualityTimer;
 };
 
 #endif // TIKZVIEW_H
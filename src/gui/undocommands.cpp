@@ -29,16 +29,14 @@ GraphUpdateCommand::GraphUpdateCommand(TikzScene *scene, QUndoCommand *parent) :
 
 void GraphUpdateCommand::undo()
 {
-    _scene->tikzDocument()->refreshTikz();
-    _scene->refreshSceneBounds();
-    _scene->invalidate();
+    _scene->refreshVisible();
+    _scene->requestRefresh();
 }
 
 void GraphUpdateCommand::redo()
 {
-    _scene->tikzDocument()->refreshTikz();
-    _scene->refreshSceneBounds();
-    _scene->invalidate();
+    _scene->refreshVisible();
+    _scene->requestRefresh();
 }
 
 
@@ -54,11 +52,9 @@ MoveCommand::MoveCommand(TikzScene *scene,
 
 void MoveCommand::undo()
 {
-    foreach (NodeItem *ni, _scene->nodeItems()) {
-        if (_oldNodePositions.contains(ni->node())) {
-            ni->node()->setPoint(_oldNodePositions.value(ni->node()));
-            ni->readPos();
-        }
+    for (auto it = _oldNodePositions.begin(); it != _oldNodePositions.end(); ++it) {
+        it.key()->setPoint(it.value());
+        if (NodeItem *ni = _scene->nodeItems().value(it.key())) ni->readPos();
     }
 
     _scene->refreshAdjacentEdges(_oldNodePositions.keys());
@@ -67,11 +63,9 @@ void MoveCommand::undo()
 
 void MoveCommand::redo()
 {
-    foreach (NodeItem *ni, _scene->nodeItems()) {
-        if (_newNodePositions.contains(ni->node())) {
-            ni->node()->setPoint(_newNodePositions.value(ni->node()));
-            ni->readPos();
-        }
+    for (auto it = _newNodePositions.begin(); it != _newNodePositions.end(); ++it) {
+        it.key()->setPoint(it.value());
+        if (NodeItem *ni = _scene->nodeItems().value(it.key())) ni->readPos();
     }
 
     _scene->refreshAdjacentEdges(_newNodePositions.keys());
@@ -99,15 +93,7 @@ void EdgeBendCommand::undo()
     _edge->setInAngle(_oldInAngle);
     _edge->setOutAngle(_oldOutAngle);
 
-    foreach(EdgeItem *ei, _scene->edgeItems()) {
-        if (ei->edge() == _edge) {
-            ei->readPos();
-
-            Path *p = ei->edge()->path();
-            if (p) _scene->pathItems()[p]->readPos();
-            break;
-        }
-    }
+    _scene->refreshEdge(_edge);
     GraphUpdateCommand::undo();
 }
 
@@ -118,15 +104,7 @@ void EdgeBendCommand::redo()
     _edge->setInAngle(_newInAngle);
     _edge->setOutAngle(_newOutAngle);
 
-    foreach(EdgeItem *ei, _scene->edgeItems()) {
-        if (ei->edge() == _edge) {
-            ei->readPos();
-
-            Path *p = ei->edge()->path();
-            if (p) _scene->pathItems()[p]->readPos();
-            break;
-        }
-    }
+    _scene->refreshEdge(_edge);
 
     GraphUpdateCommand::redo();
 }
@@ -148,48 +126,35 @@ void DeleteCommand::undo()
         Node *n = it.value();
         n->attachStyle(); // in case styles have changed
         _scene->graph()->addNode(n, it.key());
-        NodeItem *ni = new NodeItem(n);
-        _scene->nodeItems().insert(n, ni);
-        _scene->addItem(ni);
-        if (_selNodes.contains(n)) ni->setSelected(true);
+        _scene->addNodeItem(n);
+        if (_selNodes.contains(n)) _scene->setNodeSelected(n, true);
     }
 
     for (auto it = _deleteEdges.begin(); it != _deleteEdges.end(); ++it) {
         Edge *e = it.value();
 		e->attachStyle();
         _scene->graph()->addEdge(e, it.key());
-        EdgeItem *ei = new EdgeItem(e);
-        _scene->edgeItems().insert(e, ei);
-        _scene->addItem(ei);
-
-        if (_selEdges.contains(e)) ei->setSelected(true);
+        _scene->addEdgeItem(e);
+        if (_selEdges.contains(e)) _scene->setEdgeSelected(e, true);
     }
 
-    _scene->refreshZIndices();
+    _scene->placeNodesInZOrder(_deleteNodes.keys().toVector());
+    _scene->placeEdgesInZOrder(_deleteEdges.keys().toVector());
     GraphUpdateCommand::undo();
 }
 
 void DeleteCommand::redo()
 {
     foreach (Edge *e, _deleteEdges.values()) {
-        EdgeItem *ei = _scene->edgeItems()[e];
-        _scene->edgeItems().remove(e);
-        _scene->removeItem(ei);
-        delete ei;
-
+        _scene->dropEdgeItem(e);
         _scene->graph()->removeEdge(e);
     }
 
     foreach (Node *n, _deleteNodes.values()) {
-        NodeItem *ni = _scene->nodeItems()[n];
-        _scene->nodeItems().remove(n);
-        _scene->removeItem(ni);
-        delete ni;
-
+        _scene->dropNodeItem(n);
         _scene->graph()->removeNode(n);
     }
 
-    _scene->refreshZIndices();
     GraphUpdateCommand::redo();
 }
 
@@ -200,16 +165,11 @@ AddNodeCommand::AddNodeCommand(TikzScene *scene, Node *node, QRectF newBounds, Q
 
 void AddNodeCommand::undo()
 {
-    NodeItem *ni = _scene->nodeItems()[_node];
-    _scene->removeItem(ni);
-    _scene->nodeItems().remove(_node);
-    delete ni;
-
+    _scene->dropNodeItem(_node);
     _scene->graph()->removeNode(_node);
 
     //_scene->setBounds(_oldBounds);
 
-    _scene->refreshZIndices();
     GraphUpdateCommand::undo();
 }
 
@@ -217,13 +177,11 @@ void AddNodeCommand::redo()
 {
     _node->attachStyle(); // do for every redo, in case styles have changed
     _scene->graph()->addNode(_node);
-    NodeItem *ni = new NodeItem(_node);
-    _scene->nodeItems().insert(_node, ni);
-    _scene->addItem(ni);
+    _scene->addNodeItem(_node);
 
     //_scene->setBounds(_newBounds);
 
-    _scene->refreshZIndices();
+    _scene->placeNodesInZOrder(QVector<int>() << _scene->graph()->nodes().size() - 1);
     GraphUpdateCommand::redo();
 }
 
@@ -241,23 +199,10 @@ AddEdgeCommand::AddEdgeCommand(TikzScene *scene,
 
 void AddEdgeCommand::undo()
 {
-    EdgeItem *ei = _scene->edgeItems()[_edge];
-    _scene->removeItem(ei);
-    _scene->edgeItems().remove(_edge);
-    delete ei;
-
+    _scene->dropEdgeItem(_edge);
     _scene->graph()->removeEdge(_edge);
-    _scene->refreshZIndices();
 
-    if (_selectEdge) {
-        foreach (NodeItem *ni, _scene->nodeItems()) {
-            ni->setSelected(_selNodes.contains(ni->node()));
-        }
-
-        foreach (EdgeItem *ei, _scene->edgeItems()) {
-            ei->setSelected(_selEdges.contains(ei->edge()));
-        }
-    }
+    if (_selectEdge) _scene->setSelection(_selNodes, _selEdges);
 
     GraphUpdateCommand::undo();
 }
@@ -266,20 +211,12 @@ void AddEdgeCommand::redo()
 {
     _edge->attachStyle(); // do for every redo, in case styles have changed
     _scene->graph()->addEdge(_edge);
-    EdgeItem *ei = new EdgeItem(_edge);
-    _scene->edgeItems().insert(_edge, ei);
-    _scene->addItem(ei);
+    _scene->addEdgeItem(_edge);
 
-    if (!_scene->graph()->nodes().isEmpty()) {
-        ei->stackBefore(_scene->nodeItems()[_scene->graph()->nodes().first()]);
-    }
+    // edges are always below nodes, so the new edge just goes on top of the others
+    _scene->placeEdgesInZOrder(QVector<int>() << _scene->graph()->edges().size() - 1);
 
-    _scene->refreshZIndices();
-
-    if (_selectEdge) {
-        _scene->clearSelection();
-        ei->setSelected(true);
-    }
+    if (_selectEdge) _scene->setSelection(QSet<Node*>(), QSet<Edge*>() << _edge);
     GraphUpdateCommand::redo();
 }
 
@@ -292,9 +229,7 @@ void ChangeEdgeModeCommand::undo()
 {
     // FIXME: this act strangely sometimes
 	_edge->setBasicBendMode(!_edge->basicBendMode());
-    _scene->edgeItems()[_edge]->readPos();
-    Path *p = _edge->path();
-    if (p) _scene->pathItems()[p]->readPos();
+    _scene->refreshEdge(_edge);
 
     GraphUpdateCommand::undo();
 }
@@ -302,9 +237,7 @@ void ChangeEdgeModeCommand::undo()
 void ChangeEdgeModeCommand::redo()
 {
     _edge->setBasicBendMode(!_edge->basicBendMode());
-    _scene->edgeItems()[_edge]->readPos();
-    Path *p = _edge->path();
-    if (p) _scene->pathItems()[p]->readPos();
+    _scene->refreshEdge(_edge);
 
     GraphUpdateCommand::redo();
 }
@@ -312,10 +245,8 @@ void ChangeEdgeModeCommand::redo()
 ApplyStyleToNodesCommand::ApplyStyleToNodesCommand(TikzScene *scene, QString style, QUndoCommand *parent) :
     GraphUpdateCommand(scene, parent), _style(style), _oldStyles()
 {
-    foreach (QGraphicsItem *it, scene->selectedItems()) {
-        if (NodeItem *ni = dynamic_cast<NodeItem*>(it)) {
-            _oldStyles.insert(ni->node(), ni->node()->styleName());
-        }
+    foreach (Node *n, scene->selectedNodes()) {
+        _oldStyles.insert(n, n->styleName());
     }
 }
 
@@ -324,6 +255,7 @@ void ApplyStyleToNodesCommand::undo()
     foreach (Node *n, _oldStyles.keys()) {
         n->setStyleName(_oldStyles[n]);
         n->attachStyle();
+        if (NodeItem *ni = _scene->nodeItems().value(n)) ni->updateBounds();
     }
 	_scene->refreshAdjacentEdges(_oldStyles.keys());
 
@@ -335,6 +267,7 @@ void ApplyStyleToNodesCommand::redo()
     foreach (Node *n, _oldStyles.keys()) {
         n->setStyleName(_style);
         n->attachStyle();
+        if (NodeItem *ni = _scene->nodeItems().value(n)) ni->updateBounds();
     }
 	_scene->refreshAdjacentEdges(_oldStyles.keys());
 
@@ -345,10 +278,8 @@ void ApplyStyleToNodesCommand::redo()
 ApplyStyleToEdgesCommand::ApplyStyleToEdgesCommand(TikzScene * scene, QString style, QUndoCommand * parent) :
 	GraphUpdateCommand(scene, parent), _style(style), _oldStyles()
 {
-	foreach(QGraphicsItem *it, scene->selectedItems()) {
-		if (EdgeItem *ei = dynamic_cast<EdgeItem*>(it)) {
-			_oldStyles.insert(ei->edge(), ei->edge()->styleName());
-		}
+	foreach(Edge *e, scene->selectedEdges()) {
+		_oldStyles.insert(e, e->styleName());
 	}
 }
 
@@ -357,6 +288,7 @@ void ApplyStyleToEdgesCommand::undo()
 	foreach(Edge *e, _oldStyles.keys()) {
 		e->setStyleName(_oldStyles[e]);
 		e->attachStyle();
+		_scene->refreshEdge(e);
 	}
 
 	GraphUpdateCommand::undo();
@@ -367,6 +299,7 @@ void ApplyStyleToEdgesCommand::redo()
 	foreach(Edge *e, _oldStyles.keys()) {
 		e->setStyleName(_style);
 		e->attachStyle();
+		_scene->refreshEdge(e);
 	}
 	GraphUpdateCommand::redo();
 }
@@ -379,46 +312,32 @@ PasteCommand::PasteCommand(TikzScene *scene, Graph *graph, QUndoCommand *parent)
 
 void PasteCommand::undo()
 {
-    _scene->clearSelection();
+    _scene->deselectAll();
 
     foreach (Path *p, _graph->paths()) {
-        PathItem *pi = _scene->pathItems()[p];
-        _scene->pathItems().remove(p);
-        _scene->removeItem(pi);
-        delete pi;
-
+        _scene->dropPathItem(p);
         p->removeEdges();
         _scene->graph()->removePath(p);
     }
 
     foreach (Edge *e, _graph->edges()) {
-        EdgeItem *ei = _scene->edgeItems()[e];
-        _scene->edgeItems().remove(e);
-        _scene->removeItem(ei);
-        delete ei;
-
+        _scene->dropEdgeItem(e);
         _scene->graph()->removeEdge(e);
     }
 
     foreach (Node *n, _graph->nodes()) {
-        NodeItem *ni = _scene->nodeItems()[n];
-        _scene->nodeItems().remove(n);
-        _scene->removeItem(ni);
-        delete ni;
-
+        _scene->dropNodeItem(n);
         _scene->graph()->removeNode(n);
     }
 
-	foreach(Node *n, _oldSelectedNodes) _scene->nodeItems()[n]->setSelected(true);
-	foreach(Edge *e, _oldSelectedEdges) _scene->edgeItems()[e]->setSelected(true);
+	_scene->setSelection(_oldSelectedNodes, _oldSelectedEdges);
 
-    _scene->refreshZIndices();
     GraphUpdateCommand::undo();
 }
 
 void PasteCommand::redo()
 {
-    _scene->clearSelection();
+    _scene->deselectAll();
     _scene->graph()->insertGraph(_graph);
 
     foreach (Path *p, _graph->paths()) {
@@ -429,20 +348,23 @@ void PasteCommand::redo()
 
     foreach (Edge *e, _graph->edges()) {
 		e->attachStyle(); // in case styles have changed
-        EdgeItem *ei = new EdgeItem(e);
-        _scene->edgeItems().insert(e, ei);
-        _scene->addItem(ei);
+        _scene->addEdgeItem(e);
     }
 
     foreach (Node *n, _graph->nodes()) {
         n->attachStyle(); // in case styles have changed
-        NodeItem *ni = new NodeItem(n);
-        _scene->nodeItems().insert(n, ni);
-        _scene->addItem(ni);
-        ni->setSelected(true);
-    }
-
-    _scene->refreshZIndices();
+        _scene->addNodeItem(n);
+        _scene->setNodeSelected(n, true);
+    }
+
+    // the pasted elements are at the end of the graph
+    QVector<int> nodeIndices, edgeIndices;
+    int numNodes = _scene->graph()->nodes().size();
+    int numEdges = _scene->graph()->edges().size();
+    for (int i = numNodes - _graph->nodes().size(); i < numNodes; ++i) nodeIndices << i;
+    for (int i = numEdges - _graph->edges().size(); i < numEdges; ++i) edgeIndices << i;
+    _scene->placeNodesInZOrder(nodeIndices);
+    _scene->placeEdgesInZOrder(edgeIndices);
     GraphUpdateCommand::redo();
 }
 
@@ -455,7 +377,7 @@ void ChangeLabelCommand::undo()
 {
     foreach (Node *n, _oldLabels.keys()) {
         n->setLabel(_oldLabels[n]);
-		NodeItem *ni = _scene->nodeItems()[n];
+		NodeItem *ni = _scene->nodeItems().value(n);
 		if (ni != nullptr) ni->updateBounds();
     }
 
@@ -466,7 +388,7 @@ void ChangeLabelCommand::redo()
 {
     foreach (Node *n, _oldLabels.keys()) {
         n->setLabel(_newLabel);
-		NodeItem *ni = _scene->nodeItems()[n];
+		NodeItem *ni = _scene->nodeItems().value(n);
 		if (ni != nullptr) ni->updateBounds();
     }
 
@@ -571,25 +493,45 @@ ReorderCommand::ReorderCommand(TikzScene *scene,
                                const QVector<Edge *> &oldEdgeOrder,
                                const QVector<Edge *> &newEdgeOrder,
                                QUndoCommand *parent) :
+    GraphUpdateCommand(scene, parent)
+{
+    ZOrder<Node>::delta(oldNodeOrder, newNodeOrder,
+                        _oldNodes, _oldNodeIndices, _newNodes, _newNodeIndices);
+    ZOrder<Edge>::delta(oldEdgeOrder, newEdgeOrder,
+                        _oldEdges, _oldEdgeIndices, _newEdges, _newEdgeIndices);
+}
+
+ReorderCommand::ReorderCommand(TikzScene *scene,
+                               const QVector<Node *> &nodes,
+                               const QVector<int> &oldNodeIndices,
+                               const QVector<int> &newNodeIndices,
+                               const QVector<Edge *> &edges,
+                               const QVector<int> &oldEdgeIndices,
+                               const QVector<int> &newEdgeIndices,
+                               QUndoCommand *parent) :
     GraphUpdateCommand(scene, parent),
-    _oldNodeOrder(oldNodeOrder), _newNodeOrder(newNodeOrder),
-    _oldEdgeOrder(oldEdgeOrder), _newEdgeOrder(newEdgeOrder)
+    _oldNodes(nodes), _oldNodeIndices(oldNodeIndices),
+    _newNodes(nodes), _newNodeIndices(newNodeIndices),
+    _oldEdges(edges), _oldEdgeIndices(oldEdgeIndices),
+    _newEdges(edges), _newEdgeIndices(newEdgeIndices)
 {
 }
 
 void ReorderCommand::undo()
 {
-    _scene->graph()->reorderNodes(_oldNodeOrder);
-    _scene->graph()->reorderEdges(_oldEdgeOrder);
-    _scene->refreshZIndices();
+    _scene->graph()->moveNodes(_oldNodes, _oldNodeIndices);
+    _scene->graph()->moveEdges(_oldEdges, _oldEdgeIndices);
+    _scene->placeNodesInZOrder(_oldNodeIndices);
+    _scene->placeEdgesInZOrder(_oldEdgeIndices);
     GraphUpdateCommand::undo();
 }
 
 void ReorderCommand::redo()
 {
-    _scene->graph()->reorderNodes(_newNodeOrder);
-    _scene->graph()->reorderEdges(_newEdgeOrder);
-    _scene->refreshZIndices();
+    _scene->graph()->moveNodes(_newNodes, _newNodeIndices);
+    _scene->graph()->moveEdges(_newEdges, _newEdgeIndices);
+    _scene->placeNodesInZOrder(_newNodeIndices);
+    _scene->placeEdgesInZOrder(_newEdgeIndices);
     GraphUpdateCommand::redo();
 }
 
@@ -605,7 +547,7 @@ void ReverseEdgesCommand::undo()
     EdgeItem *ei;
     foreach (Edge *e, _edgeSet) {
         e->reverse();
-        ei = _scene->edgeItems()[e];
+        ei = _scene->edgeItems().value(e);
         if (ei) ei->readPos();
     }
     GraphUpdateCommand::undo();
@@ -616,7 +558,7 @@ void ReverseEdgesCommand::redo()
     EdgeItem *ei;
     foreach (Edge *e, _edgeSet) {
         e->reverse();
-        ei = _scene->edgeItems()[e];
+        ei = _scene->edgeItems().value(e);
         if (ei) ei->readPos();
     }
     GraphUpdateCommand::redo();
@@ -636,11 +578,7 @@ void MakePathCommand::undo()
 {
     Path *p = _edgeList.first()->path();
 
-    PathItem *pi = _scene->pathItems()[p];
-    _scene->removeItem(pi);
-    _scene->pathItems().remove(p);
-    delete pi;
-
+    _scene->dropPathItem(p);
     p->removeEdges();
     _scene->graph()->removePath(p);
 
@@ -649,9 +587,10 @@ void MakePathCommand::undo()
             // setData transfers ownership, so make a copy
             e->setData(_oldEdgeData[e]->copy());
         }
+        if (EdgeItem *ei = _scene->edgeItems().value(e)) ei->readPos();
     }
 
-    _scene->refreshZIndices();
+    _scene->refreshZIndex(_edgeList.first());
     GraphUpdateCommand::undo();
 }
 
@@ -680,7 +619,11 @@ void MakePathCommand::redo()
     _scene->pathItems().insert(p, pi);
     pi->readPos();
 
-    _scene->refreshZIndices();
+    foreach (Edge *e, _edgeList) {
+        if (EdgeItem *ei = _scene->edgeItems().value(e)) ei->readPos();
+    }
+
+    _scene->refreshZIndex(_edgeList.first());
     GraphUpdateCommand::redo();
 }
 
@@ -705,24 +648,27 @@ void SplitPathCommand::undo()
         _scene->addItem(pi);
         _scene->pathItems().insert(p, pi);
         pi->readPos();
+        foreach (Edge *e, p->edges()) {
+            if (EdgeItem *ei = _scene->edgeItems().value(e)) ei->readPos();
+        }
+        _scene->refreshZIndex(p->edges().first());
     }
 
-    _scene->refreshZIndices();
     GraphUpdateCommand::undo();
 }
 
 void SplitPathCommand::redo()
 {
     foreach (Path *p, _paths) {
-        PathItem *pi = _scene->pathItems()[p];
-        _scene->removeItem(pi);
-        _scene->pathItems().remove(p);
-        delete pi;
-
+        Edge *first = p->edges().first();
+        _scene->dropPathItem(p);
         p->removeEdges();
         _scene->graph()->removePath(p);
+        foreach (Edge *e, _edgeLists[p]) {
+            if (EdgeItem *ei = _scene->edgeItems().value(e)) ei->readPos();
+        }
+        _scene->refreshZIndex(first);
     }
 
-    _scene->refreshZIndices();
     GraphUpdateCommand::redo();
 }
@@ -237,6 +237,11 @@ private:
     bool _clockwise;
 };
 
+/*!
+ * \brief The ReorderCommand class changes the order of nodes and edges. Rather than
+ * storing both orders in full, it only records the elements that move, with their
+ * positions before and after.
+ */
 class ReorderCommand : public GraphUpdateCommand
 {
 public:
@@ -246,13 +251,30 @@ public:
                             const QVector<Edge*> &oldEdgeOrder,
                             const QVector<Edge*> &newEdgeOrder,
                             QUndoCommand *parent = nullptr);
+
+    /*!
+     * \brief ReorderCommand moves the given nodes and edges from the old positions to
+     * the new ones (both ascending). The moved elements keep their relative order.
+     */
+    explicit ReorderCommand(TikzScene *scene,
+                            const QVector<Node*> &nodes,
+                            const QVector<int> &oldNodeIndices,
+                            const QVector<int> &newNodeIndices,
+                            const QVector<Edge*> &edges,
+                            const QVector<int> &oldEdgeIndices,
+                            const QVector<int> &newEdgeIndices,
+                            QUndoCommand *parent = nullptr);
     void undo() override;
     void redo() override;
 private:
-    QVector<Node*> _oldNodeOrder;
-    QVector<Node*> _newNodeOrder;
-    QVector<Edge*> _oldEdgeOrder;
-    QVector<Edge*> _newEdgeOrder;
+    QVector<Node*> _oldNodes;
+    QVector<int> _oldNodeIndices;
+    QVector<Node*> _newNodes;
+    QVector<int> _newNodeIndices;
+    QVector<Edge*> _oldEdges;
+    QVector<int> _oldEdgeIndices;
+    QVector<Edge*> _newEdges;
+    QVector<int> _newEdgeIndices;
 };
 
 class MakePathCommand : public GraphUpdateCommand
@@ -0,0 +1,213 @@
+#include "testgeometry.h"
+#include "graph.h"
+#include "zorder.h"
+#include "graphindex.h"
+#include "util.h"
+
+#include <QTest>
+#include <QVector>
+#include <QRectF>
+#include <QPointF>
+
+static bool keysIncrease(const ZOrder<Node> &z, const QVector<Node*> &order)
+{
+    for (int i = 1; i < order.size(); ++i) {
+        if (z.key(order[i - 1]) >= z.key(order[i])) return false;
+    }
+    return true;
+}
+
+void TestGeometry::zOrder()
+{
+    Graph *g = new Graph();
+    QVector<Node*> ns;
+    for (int i = 0; i < 4; ++i) {
+        Node *n = new Node();
+        g->addNode(n);
+        ns << n;
+    }
+
+    ZOrder<Node> z;
+    z.assign(g->nodes());
+    for (int i = 0; i < 4; ++i) QCOMPARE(z.key(ns[i]), qreal(i));
+
+    // a node without a key is treated as being on top
+    Node *extra = new Node();
+    QVERIFY(z.key(extra) > z.key(ns[3]));
+
+    // inserting only gives a key to the new node
+    g->addNode(extra, 2);
+    QVERIFY(z.place(g->nodes(), QVector<int>() << 2));
+    QVERIFY(keysIncrease(z, g->nodes()));
+    QCOMPARE(z.key(ns[2]), qreal(2));
+
+    // inserting at either end
+    Node *bottom = new Node();
+    Node *top = new Node();
+    g->addNode(bottom, 0);
+    QVERIFY(z.place(g->nodes(), QVector<int>() << 0));
+    g->addNode(top);
+    QVERIFY(z.place(g->nodes(), QVector<int>() << g->nodes().size() - 1));
+    QVERIFY(keysIncrease(z, g->nodes()));
+
+    // repeatedly inserting into the same gap eventually runs out of room
+    bool placed = true;
+    for (int i = 0; i < 100 && placed; ++i) {
+        g->addNode(new Node(), 2);
+        placed = z.place(g->nodes(), QVector<int>() << 2);
+    }
+    QVERIFY(!placed);
+
+    z.assign(g->nodes());
+    QVERIFY(keysIncrease(z, g->nodes()));
+
+    delete g;
+}
+
+void TestGeometry::zOrderReorder()
+{
+    Graph *g = new Graph();
+    QVector<Node*> ns;
+    for (int i = 0; i < 6; ++i) {
+        Node *n = new Node();
+        g->addNode(n);
+        ns << n;
+    }
+
+    ZOrder<Node> z;
+    z.assign(g->nodes());
+    QVector<Node*> oldOrder = g->nodes();
+
+    QVector<Node*> oldMoved, newMoved;
+    QVector<int> oldIndices, newIndices;
+
+    // an unchanged order moves nothing
+    ZOrder<Node>::delta(oldOrder, oldOrder, oldMoved, oldIndices, newMoved, newIndices);
+    QVERIFY(oldMoved.isEmpty() && newMoved.isEmpty());
+
+    // 1, 2, 3, 4 keep their relative order, so only 0 and 5 move
+    QVector<Node*> newOrder;
+    newOrder << ns[1] << ns[2] << ns[5] << ns[3] << ns[4] << ns[0];
+    ZOrder<Node>::delta(oldOrder, newOrder, oldMoved, oldIndices, newMoved, newIndices);
+    QCOMPARE(oldMoved, QVector<Node*>() << ns[0] << ns[5]);
+    QCOMPARE(oldIndices, QVector<int>() << 0 << 5);
+    QCOMPARE(newMoved, QVector<Node*>() << ns[5] << ns[0]);
+    QCOMPARE(newIndices, QVector<int>() << 2 << 5);
+
+    // redo
+    g->moveNodes(newMoved, newIndices);
+    QCOMPARE(g->nodes(), newOrder);
+    QVERIFY(z.place(g->nodes(), newIndices));
+    QVERIFY(keysIncrease(z, g->nodes()));
+    QCOMPARE(z.key(ns[3]), qreal(3));
+
+    // undo
+    g->moveNodes(oldMoved, oldIndices);
+    QCOMPARE(g->nodes(), oldOrder);
+    QVERIFY(z.place(g->nodes(), oldIndices));
+    QVERIFY(keysIncrease(z, g->nodes()));
+    QCOMPARE(z.key(ns[3]), qreal(3));
+
+    delete g;
+}
+
+void TestGeometry::graphIndex()
+{
+    Graph *g = new Graph();
+    Node *n0 = new Node();
+    n0->setPoint(QPointF(0.5, 0.5));
+    Node *n1 = new Node();
+    n1->setPoint(QPointF(3, 1));
+    Node *n2 = new Node();
+    n2->setPoint(QPointF(-5, -5));
+    Node *n3 = new Node();
+    n3->setPoint(QPointF(200, 0));
+    g->addNode(n0);
+    g->addNode(n1);
+    g->addNode(n2);
+    g->addNode(n3);
+    Edge *e = new Edge(n0, n1);
+    Edge *far = new Edge(n2, n3);
+    g->addEdge(e);
+    g->addEdge(far);
+
+    GraphIndex index;
+    QVERIFY(!index.isValid());
+    index.updateNode(n0);
+    QVERIFY(index.nodesIn(QRectF(0, 0, 1, 1)).isEmpty());
+
+    index.build(g);
+    QVERIFY(index.isValid());
+
+    QVector<Node*> found = index.nodesIn(QRectF(0, 0, 1, 1));
+    QCOMPARE(found, QVector<Node*>() << n0);
+
+    // a query spanning several cells, with a node in a cell but outside the rect
+    found = index.nodesIn(QRectF(0, 0, 4, 2));
+    QVERIFY(found.size() == 2 && found.contains(n0) && found.contains(n1));
+    found = index.nodesIn(QRectF(1, 0, 3, 2));
+    QCOMPARE(found, QVector<Node*>() << n1);
+
+    // an edge is found between its endpoints, and only once
+    QVector<Edge*> edges = index.edgesIn(QRectF(2, 0, 0.5, 0.5));
+    QCOMPARE(edges, QVector<Edge*>() << e);
+    edges = index.edgesIn(QRectF(0, 0, 4, 2));
+    QCOMPARE(edges.count(e), 1);
+
+    // an edge spanning too many cells is still found
+    edges = index.edgesIn(QRectF(100, -1, 1, 1));
+    QCOMPARE(edges, QVector<Edge*>() << far);
+    QVERIFY(index.edgesIn(QRectF(10, 10, 1, 1)).isEmpty());
+
+    // a huge query, as from a view zoomed far out, visits the occupied cells only
+    found = index.nodesIn(QRectF(-1e12, -1e12, 2e12, 2e12));
+    QCOMPARE(found.size(), 4);
+    edges = index.edgesIn(QRectF(-1e12, -1e12, 2e12, 2e12));
+    QVERIFY(edges.size() == 2 && edges.contains(e) && edges.contains(far));
+    found = index.nodesIn(QRectF(1e11, 1e11, 1e12, 1e12));
+    QVERIFY(found.isEmpty());
+
+    // moving a node to another cell
+    n1->setPoint(QPointF(-4.5, -4.5));
+    index.updateNode(n1);
+    found = index.nodesIn(QRectF(0, 0, 4, 2));
+    QCOMPARE(found, QVector<Node*>() << n0);
+    found = index.nodesIn(QRectF(-6, -6, 2, 2));
+    QVERIFY(found.size() == 2 && found.contains(n1) && found.contains(n2));
+
+    e->updateControls();
+    index.updateEdge(e);
+    QVERIFY(index.edgesIn(QRectF(2, 0, 0.5, 0.5)).isEmpty());
+    QVERIFY(index.edgesIn(QRectF(-3, -3, 0.5, 0.5)).contains(e));
+
+    index.removeNode(n0);
+    QVERIFY(index.nodesIn(QRectF(0, 0, 1, 1)).isEmpty());
+    index.removeEdge(far);
+    QVERIFY(index.edgesIn(QRectF(100, -1, 1, 1)).isEmpty());
+
+    index.invalidate();
+    QVERIFY(!index.isValid());
+    QVERIFY(index.nodesIn(QRectF(-10, -10, 20, 20)).isEmpty());
+
+    delete g;
+}
+
+void TestGeometry::bezierDistance()
+{
+    // a straight curve
+    QPointF a(0, 0), b(1, 0), c(2, 0), d(3, 0);
+    QVERIFY(almostEqual(distanceToBezier(QPointF(1.5, 1), a, b, c, d, 0.01), 1.0));
+    QVERIFY(almostEqual(distanceToBezier(QPointF(4, 0), a, b, c, d, 0.01), 1.0));
+    QVERIFY(almostEqual(distanceToBezier(QPointF(-3, -4), a, b, c, d, 0.01), 5.0));
+
+    // an arch, whose nearest point to (0.5, 2) is its apex at (0.5, 0.75)
+    QPointF c0(0, 0), c1(0, 1), c2(1, 1), c3(1, 0);
+    QVERIFY(qAbs(distanceToBezier(QPointF(0.5, 2), c0, c1, c2, c3, 0.01) - 1.25) <= 0.01);
+    QVERIFY(qAbs(distanceToBezier(QPointF(0.5, 2), c0, c1, c2, c3, 0.001) - 1.25) <= 0.001);
+
+    // points on the curve
+    for (int i = 0; i <= 10; ++i) {
+        QPointF p = bezierInterpolateFull(i / 10.0, c0, c1, c2, c3);
+        QVERIFY(distanceToBezier(p, c0, c1, c2, c3, 0.01) <= 0.01);
+    }
+}
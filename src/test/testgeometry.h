@@ -0,0 +1,16 @@
+#ifndef TESTGEOMETRY_H
+#define TESTGEOMETRY_H
+
+#include <QObject>
+
+class TestGeometry : public QObject
+{
+    Q_OBJECT
+private slots:
+    void zOrder();
+    void zOrderReorder();
+    void graphIndex();
+    void bezierDistance();
+};
+
+#endif // TESTGEOMETRY_H
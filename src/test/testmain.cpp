@@ -1,6 +1,7 @@
 #include "testtest.h"
 #include "testparser.h"
 #include "testtikzoutput.h"
+#include "testgeometry.h"
 
 #include <QTest>
 #include <QDebug>
@@ -11,9 +12,11 @@ int main(int argc, char *argv[])
     TestTest test;
     TestParser parser;
     TestTikzOutput tikzOutput;
+    TestGeometry geometry;
     int r = QTest::qExec(&test, argc, argv) |
             QTest::qExec(&parser, argc, argv) |
-            QTest::qExec(&tikzOutput, argc, argv);
+            QTest::qExec(&tikzOutput, argc, argv) |
+            QTest::qExec(&geometry, argc, argv);
 
     if (r == 0) std::cout << "***************** All tests passed! *****************\n";
     else std::cout << "***************** Some tests failed. *****************\n";
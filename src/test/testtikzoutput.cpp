@@ -3,6 +3,7 @@
 #include "graphelementdata.h"
 #include "graph.h"
 #include "tikzassembler.h"
+#include "sourcemap.h"
 
 #include <QTest>
 #include <QRectF>
@@ -93,5 +94,111 @@ void TestTikzOutput::graphBbox()
     QVERIFY(g->tikz() == tikz);
 
 
+    delete g;
+}
+
+void TestTikzOutput::graphTexKey()
+{
+    Graph *g1 = new Graph();
+    Graph *g2 = new Graph();
+    Graph *g3 = new Graph();
+    TikzAssembler ga1(g1);
+    TikzAssembler ga2(g2);
+    TikzAssembler ga3(g3);
+
+    ga1.parse(
+    "\\begin{tikzpicture}\n"
+    "\t\\begin{pgfonlayer}{nodelayer}\n"
+    "\t\t\\node [style=white dot] (0) at (-1, -1) {};\n"
+    "\t\t\\node [style=white dot] (1) at (0, 1) {};\n"
+    "\t\\end{pgfonlayer}\n"
+    "\t\\begin{pgfonlayer}{edgelayer}\n"
+    "\t\t\\draw [style=diredge] (1) to (0);\n"
+    "\t\\end{pgfonlayer}\n"
+    "\\end{tikzpicture}\n");
+
+    // different names, spacing and TikZiT-only properties
+    ga2.parse(
+    "\\begin{tikzpicture}\n"
+    "\t\\begin{pgfonlayer}{nodelayer}\n"
+    "\t\t\\node [style=white  dot, tikzit fill=red] (a) at (-1, -1) {};\n"
+    "\t\t\\node [style=white dot] (b) at (0, 1) {};\n"
+    "\t\\end{pgfonlayer}\n"
+    "\t\\begin{pgfonlayer}{edgelayer}\n"
+    "\t\t\\draw [style=diredge] (b) to (a);\n"
+    "\t\\end{pgfonlayer}\n"
+    "\\end{tikzpicture}\n");
+
+    // a node in a different place
+    ga3.parse(
+    "\\begin{tikzpicture}\n"
+    "\t\\begin{pgfonlayer}{nodelayer}\n"
+    "\t\t\\node [style=white dot] (0) at (-1, -1) {};\n"
+    "\t\t\\node [style=white dot] (1) at (0, 2) {};\n"
+    "\t\\end{pgfonlayer}\n"
+    "\t\\begin{pgfonlayer}{edgelayer}\n"
+    "\t\t\\draw [style=diredge] (1) to (0);\n"
+    "\t\\end{pgfonlayer}\n"
+    "\\end{tikzpicture}\n");
+
+    QVERIFY(g1->texKey() == g2->texKey());
+    QVERIFY(g1->texKey() != g3->texKey());
+
+    delete g1;
+    delete g2;
+    delete g3;
+}
+
+void TestTikzOutput::sourceMap()
+{
+    Node a, b, c;
+    SourceMap m;
+    m.addNode(&a, 2, 5);
+    m.addNode(&b, 5, 9);
+
+    QVERIFY(m.nodeAt(0) == nullptr);
+    QVERIFY(m.nodeAt(1) == nullptr);
+    QVERIFY(m.nodeAt(2) == &a);
+    QVERIFY(m.nodeAt(4) == &a);
+    // where two spans meet, the later one wins
+    QVERIFY(m.nodeAt(5) == &b);
+    QVERIFY(m.nodeAt(9) == &b);
+    QVERIFY(m.nodeAt(10) == nullptr);
+    QVERIFY(m.nodeRange(&b) == qMakePair(5, 9));
+    QVERIFY(m.nodeRange(&c) == qMakePair(-1, -1));
+
+    Graph *g = new Graph();
+    Node *n0 = new Node();
+    n0->setName("0");
+    Node *n1 = new Node();
+    n1->setName("1");
+    n1->setPoint(QPointF(1, 0));
+    g->addNode(n0);
+    g->addNode(n1);
+    Edge *e = new Edge(n0, n1);
+    g->addEdge(e);
+
+    QString tikz = g->tikz();
+    const SourceMap &sm = g->sourceMap();
+
+    foreach (Node *n, g->nodes()) {
+        QPair<int,int> r = sm.nodeRange(n);
+        QVERIFY(tikz.mid(r.first).startsWith("\\node"));
+        QVERIFY(tikz[r.second - 1] == ';');
+        QVERIFY(sm.nodeAt(r.first) == n);
+        QVERIFY(sm.nodeAt(r.second) == n);
+        QVERIFY(sm.nodeAt(r.first - 1) == nullptr);
+        QVERIFY(sm.nodeAt(r.second + 1) == nullptr);
+    }
+
+    QPair<int,int> r = sm.edgeRange(e);
+    QVERIFY(tikz.mid(r.first).startsWith("\\draw"));
+    QVERIFY(tikz[r.second - 1] == ';');
+    QVERIFY(sm.edgeAt(r.first) == e);
+    QVERIFY(sm.edgeAt(r.second) == e);
+    QVERIFY(sm.nodeAt(r.first) == nullptr);
+    QVERIFY(sm.edgeAt(r.first - 1) == nullptr);
+    QVERIFY(sm.edgeAt(tikz.length()) == nullptr);
+
     delete g;
 }
@@ -12,6 +12,8 @@ private slots:
     void graphBbox();
     void graphEmpty();
     void graphFromTikz();
+    void graphTexKey();
+    void sourceMap();
 };
 
 #endif // TESTTIKZOUTPUT_H
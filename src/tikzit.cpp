@@ -39,7 +39,7 @@ Tikzit *tikzit;
 // font to use for node labels
 QFont Tikzit::LABEL_FONT("Courrier", 9);
 
-Tikzit::Tikzit() : _styleFile("[no styles]"), _activeWindow(nullptr)
+Tikzit::Tikzit() : _styleFile("[no styles]"), _activeWindow(nullptr), _previews(nullptr)
 {
 }
 
@@ -50,6 +50,9 @@ void Tikzit::init()
 	initColors();
     initTexConstants();
 
+    _preferences = new Preferences(this);
+    connect(qApp, SIGNAL(aboutToQuit()), _preferences, SLOT(flush()));
+
     _mainMenu = new MainMenu();
     QMainWindow *dummy = new QMainWindow();
 
@@ -89,7 +92,15 @@ void Tikzit::init()
     }
 
     _preview = new PreviewWindow();
-    _latex = nullptr;
+    _previews = new PreviewScheduler(_preview, this);
+    _previews->setActiveDocument(_activeWindow);
+    _figureBatch = new FigureBatch(_previews, _preview, this);
+    _latexWorker = new LatexWorker(this);
+
+    _autoPreviewTimer = new QTimer(this);
+    _autoPreviewTimer->setSingleShot(true);
+    _autoPreviewTimer->setInterval(AUTO_PREVIEW_DELAY);
+    connect(_autoPreviewTimer, SIGNAL(timeout()), this, SLOT(autoPreview()));
 }
 
 //QMenuBar *Tikzit::mainMenu() const
@@ -202,17 +213,19 @@ MainWindow *Tikzit::activeWindow() const
 void Tikzit::setActiveWindow(MainWindow *activeWindow)
 {
     _activeWindow = activeWindow;
+    if (_previews != nullptr) _previews->setActiveDocument(_activeWindow);
 }
 
 void Tikzit::removeWindow(MainWindow *w)
 {
     _windows.removeAll(w);
+    if (_previews != nullptr) _previews->removeDocument(w);
     if (_activeWindow == w) {
         if (_windows.isEmpty()) {
             _activeWindow = nullptr;
             // TODO: check if we should quit when last window closed
             quit();
-        } else _activeWindow = _windows[0];
+        } else setActiveWindow(_windows[0]);
     }
 }
 
@@ -434,22 +447,8 @@ void Tikzit::updateReply(QNetworkReply *reply, bool manual)
 void Tikzit::makePreview()
 {
     if (activeWindow()) {
-        LatexProcess *oldProc = _latex;
-        _latex = new LatexProcess(_preview, this);
-        if (oldProc != nullptr) {
-            oldProc->kill();
-            oldProc->deleteLater();
-        }
-
-        connect(_latex, SIGNAL(previewFinished()), this, SLOT(cleanupLatex()));
-
-        if (activeWindow()->tikzDocument()->isEmpty()) {
-            _latex->makePreview("\\begin{tikzpicture}\n"
-                                "  \\node [style=none] (0) at (0,0) {};\n"
-                                "\\end{tikzpicture}\n");
-        } else {
-            _latex->makePreview(activeWindow()->tikzSource());
-        }
+        _autoPreviewTimer->stop();
+        startPreview(true);
 
         _preview->show();
 
@@ -461,12 +460,46 @@ void Tikzit::makePreview()
     }
 }
 
-void Tikzit::cleanupLatex()
+void Tikzit::exportFolderImages()
+{
+    if (_figureBatch->isRunning()) return;
+
+    QSettings settings("tikzit", "tikzit");
+    QString dir = QFileDialog::getExistingDirectory(nullptr,
+                tr("Export Images of Folder"),
+                settings.value("previous-file-path").toString(),
+                QFileDialog::ShowDirsOnly | QFileDialog::DontUseNativeDialog);
+    if (dir.isEmpty()) return;
+
+    _figureBatch->exportFolder(dir);
+}
+
+void Tikzit::requestAutoPreview()
 {
-    LatexProcess *oldProc = _latex;
-    _latex = nullptr;
-    if (oldProc != nullptr) {
-        oldProc->deleteLater();
+    // only keep a preview up to date if it is being looked at. Restarting the timer
+    // drops any earlier request that hasn't been started yet.
+    if (_preferences->autoPreview() && _preview->isVisible()) _autoPreviewTimer->start();
+}
+
+void Tikzit::autoPreview()
+{
+    if (activeWindow() && _preview->isVisible()) startPreview(false);
+}
+
+void Tikzit::startPreview(bool force)
+{
+    // an automatic preview is skipped if nothing TeX would see has changed
+    QByteArray key = activeWindow()->tikzDocument()->graph()->texKey();
+    if (activeWindow()->tikzDocument()->isEmpty()) {
+        _previews->request(activeWindow(),
+                           "\\begin{tikzpicture}\n"
+                           "  \\node [style=none] (0) at (0,0) {};\n"
+                           "\\end{tikzpicture}\n",
+                           key, force);
+    } else {
+        // the document's code is kept current, unlike the source pane, which is
+        // only brought up to date when it is shown
+        _previews->request(activeWindow(), activeWindow()->tikzDocument()->tikz(), key, force);
     }
 }
 
@@ -559,6 +592,16 @@ PreviewWindow *Tikzit::previewWindow() const
     return _preview;
 }
 
+Preferences *Tikzit::preferences() const
+{
+    return _preferences;
+}
+
+LatexWorker *Tikzit::latexWorker() const
+{
+    return _latexWorker;
+}
+
 //StylePalette *Tikzit::stylePalette() const
 //{
 //    return _stylePalette;
@@ -573,6 +616,7 @@ TikzStyles *Tikzit::styles() const
 void Tikzit::quit()
 {
     //_stylePalette->close();
+    _preferences->flush();
     QApplication::quit();
 }
 
@@ -61,7 +61,11 @@
 #include "stylepalette.h"
 #include "tikzstyles.h"
 #include "latexprocess.h"
+#include "latexworker.h"
+#include "previewscheduler.h"
+#include "figurebatch.h"
 #include "previewwindow.h"
+#include "preferences.h"
 
 #include <QObject>
 #include <QVector>
@@ -72,6 +76,7 @@
 #include <QFont>
 #include <QColor>
 #include <QNetworkReply>
+#include <QTimer>
 
 // Number of pixels between (0,0) and (1,0) at 100% zoom level. This should be
 // divisible by 8 to avoid rounding errors with e.g. grid-snapping.
@@ -81,6 +86,11 @@
 #define GRID_N 4
 #define GRID_SEP 10
 #define GRID_SEPF 10.0f
+// The minor grid is not drawn when its lines are closer than this many pixels on screen
+#define GRID_MIN_PIXELS 4.0f
+
+// How long the document must be left unchanged before the preview updates itself, in ms
+#define AUTO_PREVIEW_DELAY 500
 
 
 inline QPointF toScreen(QPointF src)
@@ -139,6 +149,8 @@ public:
     void updateRecentFiles();
 
     PreviewWindow *previewWindow() const;
+    Preferences *preferences() const;
+    LatexWorker *latexWorker() const;
 
 public slots:
     void clearRecentFiles();
@@ -148,7 +160,20 @@ public slots:
     void updateManual(QNetworkReply *reply);
     void updateReply(QNetworkReply *reply, bool manual);
     void makePreview();
-    void cleanupLatex();
+
+    /*!
+     * \brief exportFolderImages asks for a folder, and saves every figure in it as
+     * a PNG image, typesetting them all in one go.
+     */
+    void exportFolderImages();
+
+    /*!
+     * \brief requestAutoPreview is called when the active document changes. If
+     * automatic previews are on and the preview is showing, a new preview is made
+     * once there have been no further changes for AUTO_PREVIEW_DELAY ms.
+     */
+    void requestAutoPreview();
+    void autoPreview();
 
 private:
     /*!
@@ -156,6 +181,7 @@ private:
      * QColor values, and adds them as standard colors to the Qt color dialog.
      */
     void initColors();
+    void startPreview(bool force);
 
     MainMenu *_mainMenu;
     ToolPalette *_toolPalette;
@@ -169,8 +195,12 @@ private:
     StyleEditor *_styleEditor;
     QStringList _colNames;
     QVector<QColor> _cols;
-    LatexProcess *_latex;
+    PreviewScheduler *_previews;
+    FigureBatch *_figureBatch;
+    LatexWorker *_latexWorker;
+    QTimer *_autoPreviewTimer;
     PreviewWindow *_preview;
+    Preferences *_preferences;
     // _activeWidget to further determine which widget (MainWindow/QDialog) to delete when invoking close shortcut, for Mac, invoking CMD+W should only removes the first top window.
     bool _dialog_active;
 };
@@ -32,6 +32,40 @@ QPointF bezierInterpolateFull (qreal dist, QPointF c0, QPointF c1, QPointF c2, Q
                    bezierInterpolate (dist, c0.y(), c1.y(), c2.y(), c3.y()));
 }
 
+qreal distanceToSegment(QPointF p, QPointF a, QPointF b) {
+    QPointF ab = b - a;
+    qreal len2 = QPointF::dotProduct(ab, ab);
+    qreal t = 0.0;
+    if (len2 > 0.0) {
+        t = QPointF::dotProduct(p - a, ab) / len2;
+        if (t < 0.0) t = 0.0;
+        else if (t > 1.0) t = 1.0;
+    }
+    QPointF d = p - (a + t * ab);
+    return sqrt(QPointF::dotProduct(d, d));
+}
+
+qreal distanceToBezier(QPointF p, QPointF c0, QPointF c1, QPointF c2, QPointF c3, qreal tolerance) {
+    // Splitting the curve into n equal parameter intervals, each chord deviates from the
+    // curve by at most M/(8n^2), where M = 6*max(|c0-2c1+c2|, |c1-2c2+c3|) bounds the second
+    // derivative. Choose n so this is within tolerance.
+    QPointF d1 = c0 - 2*c1 + c2;
+    QPointF d2 = c1 - 2*c2 + c3;
+    qreal m = 6.0 * sqrt(qMax(QPointF::dotProduct(d1, d1), QPointF::dotProduct(d2, d2)));
+    int n = qBound(1, static_cast<int>(ceil(sqrt(m / (8.0 * tolerance)))), 256);
+
+    qreal dist = -1.0;
+    QPointF prev = c0;
+    for (int i = 1; i <= n; ++i) {
+        QPointF next = (i == n) ? c3 : bezierInterpolateFull(qreal(i) / n, c0, c1, c2, c3);
+        qreal d = distanceToSegment(p, prev, next);
+        if (dist < 0.0 || d < dist) dist = d;
+        prev = next;
+    }
+
+    return dist;
+}
+
 
 qreal roundToNearest(qreal stepSize, qreal val) {
     if (stepSize==0.0) return val;
@@ -36,6 +36,10 @@
 qreal bezierInterpolate(qreal dist, qreal c0, qreal c1, qreal c2, qreal c3);
 QPointF bezierInterpolateFull (qreal dist, QPointF c0, QPointF c1, QPointF c2, QPointF c3);
 
+// distance from a point to a line segment, and to a cubic bezier curve (to within tolerance)
+qreal distanceToSegment(QPointF p, QPointF a, QPointF b);
+qreal distanceToBezier(QPointF p, QPointF c0, QPointF c1, QPointF c2, QPointF c3, qreal tolerance);
+
 // rounding
 qreal roundToNearest(qreal stepSize, qreal val);
 qreal radiansToDegrees (qreal radians);
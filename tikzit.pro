@@ -57,11 +57,14 @@ SOURCES += src/gui/mainwindow.cpp \
     src/gui/pathitem.cpp \
     src/gui/toolpalette.cpp \
     src/gui/tikzscene.cpp \
+    src/gui/tikzhighlighter.cpp \
     src/data/graph.cpp \
     src/data/node.cpp \
     src/data/edge.cpp \
     src/data/graphelementdata.cpp \
     src/data/graphelementproperty.cpp \
+    src/data/graphindex.cpp \
+    src/data/sourcemap.cpp \
     src/gui/propertypalette.cpp \
     src/gui/tikzview.cpp \
     src/gui/nodeitem.cpp \
@@ -69,6 +72,7 @@ SOURCES += src/gui/mainwindow.cpp \
     src/tikzit.cpp \
     src/gui/commands.cpp \
     src/data/tikzdocument.cpp \
+    src/data/tiledexport.cpp \
     src/gui/undocommands.cpp \
     src/gui/mainmenu.cpp \
     src/util.cpp \
@@ -79,23 +83,33 @@ SOURCES += src/gui/mainwindow.cpp \
     src/gui/styleeditor.cpp \
     src/data/stylelist.cpp \
     src/gui/previewwindow.cpp \
+    src/gui/previewcache.cpp \
     src/gui/latexprocess.cpp \
+    src/gui/latexworker.cpp \
+    src/gui/previewscheduler.cpp \
     src/data/pdfdocument.cpp \
+    src/data/pdfrenderer.cpp \
     src/gui/exportdialog.cpp \
+    src/gui/figurebatch.cpp \
     src/data/delimitedstringvalidator.cpp \
     src/gui/delimitedstringitemdelegate.cpp \
-    src/gui/preferencedialog.cpp
+    src/gui/preferencedialog.cpp \
+    src/gui/preferences.cpp
 
 HEADERS  += src/gui/mainwindow.h \
     src/data/path.h \
     src/gui/pathitem.h \
     src/gui/toolpalette.h \
     src/gui/tikzscene.h \
+    src/gui/tikzhighlighter.h \
     src/data/graph.h \
     src/data/node.h \
     src/data/edge.h \
     src/data/graphelementdata.h \
     src/data/graphelementproperty.h \
+    src/data/graphindex.h \
+    src/data/zorder.h \
+    src/data/sourcemap.h \
     src/gui/propertypalette.h \
     src/data/tikzparserdefs.h \
     src/gui/tikzview.h \
@@ -110,16 +124,23 @@ HEADERS  += src/gui/mainwindow.h \
     src/gui/stylepalette.h \
     src/data/tikzassembler.h \
     src/data/tikzstyles.h \
+    src/data/tiledexport.h \
     src/data/style.h \
     src/gui/styleeditor.h \
     src/data/stylelist.h \
     src/gui/previewwindow.h \
+    src/gui/previewcache.h \
     src/gui/latexprocess.h \
+    src/gui/latexworker.h \
+    src/gui/previewscheduler.h \
     src/data/pdfdocument.h \
+    src/data/pdfrenderer.h \
     src/gui/exportdialog.h \
+    src/gui/figurebatch.h \
     src/data/delimitedstringvalidator.h \
     src/gui/delimitedstringitemdelegate.h \
-    src/gui/preferencedialog.h
+    src/gui/preferencedialog.h \
+    src/gui/preferences.h
 
 FORMS += src/gui/mainwindow.ui \
     src/gui/propertypalette.ui \
@@ -142,11 +163,13 @@ test {
     SOURCES -= src/main.cpp
     HEADERS += src/test/testtest.h \
         src/test/testparser.h \
-        src/test/testtikzoutput.h
+        src/test/testtikzoutput.h \
+        src/test/testgeometry.h
     SOURCES += src/test/testmain.cpp \
         src/test/testtest.cpp \
         src/test/testparser.cpp \
-        src/test/testtikzoutput.cpp
+        src/test/testtikzoutput.cpp \
+        src/test/testgeometry.cpp
 } else {
     SOURCES += src/main.cpp
 }